@@ -8,9 +8,12 @@ public:
   std::string channel;
   std::string msg;
   int32_t colour;
+  // receive time in ms since the epoch, 0 when unknown
+  int64_t timeMs;
 
-  EventGameLog(std::string channel, std::string msg, int32_t colour = 0)
-      : channel(channel), msg(msg), colour(colour) {}
+  EventGameLog(std::string channel, std::string msg, int32_t colour = 0,
+               int64_t timeMs = 0)
+      : channel(channel), msg(msg), colour(colour), timeMs(timeMs) {}
 };
 
 class EventLuaError {
@@ -26,6 +26,13 @@ uint32_t GetTimeMs() {
       .count();
 }
 
+// wall clock, used to timestamp incoming packets
+int64_t GetWallTimeMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+      .count();
+}
+
 struct BreakpointInfo {
   std::string File;
   int Line;
@@ -60,6 +67,9 @@ public:
 
   bool m_IsReassembling = false;
   AIDPacketHeader m_PendingHeader;
+  // when the packet being processed arrived; for fragmented packets, when
+  // its header did
+  int64_t m_PacketTimeMs = 0;
   std::vector<uint8_t> m_ReassemblyBuffer;
   void ProcessCompletePacket(AIDPacketHeader header,
                              std::vector<uint8_t> &payloadData);
@@ -427,8 +437,8 @@ void SecondAid::ProcessCompletePacket(AIDPacketHeader header,
       char *msgPtr = (char *)payloadData.data();
       std::string channel(msgPtr);
       std::string msg(msgPtr + channel.size() + 1);
-      callbacks.OnGameLogReceived(
-          EventGameLog(channel, msg, header.Data.Log.ColorRGB));
+      callbacks.OnGameLogReceived(EventGameLog(
+          channel, msg, header.Data.Log.ColorRGB, m_PacketTimeMs));
     } else {
       callbacks.OnUnimplementedPacketReceived(pktFull);
     }
@@ -558,6 +568,7 @@ void SecondAid::ReceiverThreadFunc() {
 
     if (bytes <= 0)
       continue;
+    int64_t recvTimeMs = GetWallTimeMs();
 
     if (m_IsReassembling) {
       if (bytes >= (int)sizeof(AIDPacketHeader)) {
@@ -603,6 +614,7 @@ void SecondAid::ReceiverThreadFunc() {
     }
 
     g_LastRecvTime = GetTimeMs();
+    m_PacketTimeMs = recvTimeMs;
     if (!g_IsConnected) {
       g_IsConnected = true;
       SendLuaAttach();
@@ -82,7 +82,9 @@ void SecondAidHLAPI::ExecutionStep(int n) {
   for (int i = 0; i < n; i++) {
     aid.SendLuaStep();
     // TODO check if we reaaaly need it
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // (only between steps, a single step doesn't block the caller)
+    if (i + 1 < n)
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 }
 /*void SecondAidHLAPI::ExecutionNextBreakpoint() {
@@ -13,15 +13,19 @@
 #include "Events.hpp"
 #include "SecondAidHLAPI.hpp"
 #include "widgets/BreakpointsWindow.hpp"
+#include "widgets/ConsoleBatchWindow.hpp"
 #include "widgets/ConnectionWindow.hpp"
 #include "widgets/ConsoleWindow.hpp"
 #include "widgets/DebuggerPanel.hpp"
+#include "widgets/LogArchiveWindow.hpp"
 #include "widgets/LogWindow.hpp"
 #include "widgets/LuaErrorWindow.hpp"
 #include "widgets/ScriptEditorWindow.hpp"
 #include "widgets/ScriptExplorer.hpp"
+#include "widgets/SessionLogWindow.hpp"
 #include "widgets/StaticAnalysisOverview.hpp"
 #include "widgets/StaticAnalysisWindow.hpp"
+#include "widgets/TriggerWindow.hpp"
 #include "widgets/WatchesWindow.hpp"
 
 struct AppState {
@@ -29,6 +33,7 @@ struct AppState {
   LogWindow gameLogWindow;
   LogWindow appStatusWindow;
   ConsoleWindow consoleWindow;
+  ConsoleBatchWindow consoleBatchWindow;
   ScriptExplorer scriptExplorer;
   ScriptEditorWindow scriptEditor;
   BreakpointsWindow breakpointsWindow;
@@ -38,6 +43,11 @@ struct AppState {
   ConnectionWindow connectionWindow;
   StaticAnalysisWindow analysisWindow;
   StaticAnalysisOverview analysisOverviewWindow;
+  LogTriggers logTriggers;
+  TriggerWindow triggerWindow;
+  LogSink logSink;
+  SessionLogWindow sessionLogWindow;
+  LogArchiveWindow logArchiveWindow;
 
   std::vector<EventGameLog> pendingLogs;
   std::mutex queueMutex;
@@ -49,6 +59,8 @@ struct AppState {
   std::string CurrentContextFile = "Unknown";
   int CurrentContextLine = 0;
   std::string CurrentPauseReason = "Manual"; // "Step", "Breakpoint", "Manual"
+  // last pause a log trigger asked for, one per burst of matching lines
+  std::chrono::steady_clock::time_point TriggerPauseSent;
 
   void AddSystemLog(const std::string &msg) {
     appStatusWindow.AddLog(msg, "System", 0);
@@ -73,10 +85,7 @@ struct AppState {
     std::lock_guard<std::mutex> lock(queueMutex);
 
     for (const auto &log : pendingLogs) {
-      gameLogWindow.AddLog(log.msg, log.channel, log.colour);
-      if (log.channel == "Console") {
-        consoleWindow.AddLog(log.msg, log.colour);
-      }
+      gameLogWindow.AddLog(log.msg, log.channel, log.colour, log.timeMs);
     }
     pendingLogs.clear();
 
@@ -110,15 +119,22 @@ void SetupAidCallbacks(AppState &app) {
   };
 
   app.aid.Callbacks().OnGameLogReceived = [&app](EventGameLog event) {
+    app.logSink.Write("GAME", event.channel, event.msg,
+                      LogWindow::GetColorForCode(event.colour), event.timeMs);
     app.EnqueueLog(event);
   };
 
   app.aid.Callbacks().OnNetworkLogReceived = [&app](std::string msg,
                                                     uint32_t color) {
+    app.logSink.Write("NET", "Network", msg, LogWindow::GetColorForCode(color));
     app.EnqueueNetworkLog(msg, color);
   };
 
   app.aid.Callbacks().OnLuaError = [&app](EventLuaError err) {
+    app.logSink.Write("LUA", "Lua Error",
+                      err.script + ":" + std::to_string(err.line) + ": " +
+                          err.errorMsg,
+                      IM_COL32(255, 80, 80, 255));
     app.EnqueueLuaError(err);
     app.scriptEditor.MarkErrorLine(err.script, err.line - 1);
   };
@@ -238,6 +254,11 @@ int main(int, char **) {
 
   app.consoleWindow.SetSendCommandCallback(
       [&app](std::string cmd) { app.aid.ConsoleSendCommand(cmd); });
+  app.consoleBatchWindow.Setup(&app.gameLogWindow,
+                               [&app](const std::string &cmd) {
+                                 app.consoleWindow.EchoCommand(cmd);
+                                 app.aid.ConsoleSendCommand(cmd);
+                               });
 
   app.connectionWindow.DoAutoconnect();
 
@@ -295,6 +316,24 @@ int main(int, char **) {
         app.aid.BreakpointClearAll();
       });
 
+  app.gameLogWindow.SetTriggers(&app.logTriggers);
+  app.consoleWindow.SetSource(&app.gameLogWindow);
+  app.consoleWindow.SetGlobals(&app.scriptEditor.GetGlobals());
+  app.triggerWindow.Setup(&app.logTriggers);
+  app.sessionLogWindow.Setup(&app.logSink);
+  app.logTriggers.OnPause = [&app](const LogTrigger &trigger,
+                                   const std::string &msg) {
+    // the rest of a burst arrives before the game reports the pause
+    auto now = std::chrono::steady_clock::now();
+    if (!app.aid.IsConnected() ||
+        app.debugPanel.GetState() == DebuggerState::Paused ||
+        now - app.TriggerPauseSent < std::chrono::seconds(1))
+      return;
+    app.TriggerPauseSent = now;
+    app.AddSystemLog("Trigger '" + trigger.Pattern + "' hit, pausing: " + msg);
+    app.aid.ExecutionStep(1);
+  };
+
   app.luaErrorWindow.Setup(&app.scriptEditor);
   app.analysisWindow.Setup(&app.scriptEditor);
   app.analysisOverviewWindow.Setup(&app.scriptEditor);
@@ -338,6 +377,7 @@ int main(int, char **) {
     app.gameLogWindow.Draw("Game Logs");
     app.luaErrorWindow.Draw("Lua Errors");
     app.consoleWindow.Draw("Console");
+    app.consoleBatchWindow.Draw("Console Batch");
     app.scriptExplorer.Draw("Script Browser");
     app.scriptEditor.Draw("Script Editor");
     app.breakpointsWindow.Draw("Breakpoints");
@@ -346,6 +386,9 @@ int main(int, char **) {
     app.connectionWindow.Draw("Connection");
     app.analysisWindow.Draw("Active File Analysis");
     app.analysisOverviewWindow.Draw("Static Analysis Overview");
+    app.triggerWindow.Draw("Log Triggers");
+    app.sessionLogWindow.Draw("Session Recording");
+    app.logArchiveWindow.Draw("Log Archive");
 
     if (firstFrame) {
       ImGui::SetWindowFocus("Script Editor");
@@ -366,6 +409,7 @@ int main(int, char **) {
   }
 
   // Cleanup
+  app.logSink.Stop();
   // app.aid.Stop();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -0,0 +1,117 @@
+#pragma once
+#include "TextMatch.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Case-insensitive multi-pattern matcher. Patterns are compiled into a full
+// DFA over byte classes (every byte that never appears in a pattern shares
+// one class), so scanning a line is a single table lookup per byte no matter
+// how many patterns there are.
+class AhoCorasick {
+  uint8_t ByteClass[256] = {};
+  int ClassCount = 1;
+
+  std::vector<int32_t> Next;      // state * ClassCount + class
+  std::vector<uint32_t> OutBegin; // per state, into Outputs
+  std::vector<int32_t> Outputs;   // pattern ids, including suffix matches
+
+public:
+  void Build(const std::vector<std::string> &patterns) {
+    // byte classes, '\0' and unused bytes stay in class 0
+    for (auto &c : ByteClass)
+      c = 0;
+    ClassCount = 1;
+    for (const auto &p : patterns) {
+      for (char ch : p) {
+        uint8_t folded = (uint8_t)TextMatch::Fold(ch);
+        if (ByteClass[folded] == 0)
+          ByteClass[folded] = (uint8_t)ClassCount++;
+      }
+    }
+    for (int b = 'A'; b <= 'Z'; b++)
+      ByteClass[b] = ByteClass[b + ('a' - 'A')];
+
+    // trie
+    Next.assign(ClassCount, -1);
+    std::vector<std::vector<int32_t>> own(1);
+    for (int32_t id = 0; id < (int32_t)patterns.size(); id++) {
+      if (patterns[id].empty())
+        continue;
+      int32_t state = 0;
+      for (char ch : patterns[id]) {
+        int cls = ByteClass[(uint8_t)ch];
+        int32_t &slot = Next[state * ClassCount + cls];
+        if (slot < 0) {
+          slot = (int32_t)own.size();
+          own.emplace_back();
+          Next.resize(own.size() * ClassCount, -1);
+        }
+        state = Next[state * ClassCount + cls];
+      }
+      own[state].push_back(id);
+    }
+
+    // failure links in BFS order, turning the trie into a DFA
+    size_t stateCount = own.size();
+    std::vector<int32_t> fail(stateCount, 0);
+    std::vector<int32_t> queue;
+    queue.reserve(stateCount);
+    for (int cls = 0; cls < ClassCount; cls++) {
+      int32_t &slot = Next[cls];
+      if (slot < 0) {
+        slot = 0;
+      } else {
+        fail[slot] = 0;
+        queue.push_back(slot);
+      }
+    }
+    for (size_t head = 0; head < queue.size(); head++) {
+      int32_t s = queue[head];
+      const auto &inherited = own[fail[s]];
+      own[s].insert(own[s].end(), inherited.begin(), inherited.end());
+      for (int cls = 0; cls < ClassCount; cls++) {
+        int32_t &slot = Next[s * ClassCount + cls];
+        int32_t viaFail = Next[fail[s] * ClassCount + cls];
+        if (slot < 0) {
+          slot = viaFail;
+        } else {
+          fail[slot] = viaFail;
+          queue.push_back(slot);
+        }
+      }
+    }
+
+    OutBegin.assign(stateCount + 1, 0);
+    Outputs.clear();
+    for (size_t s = 0; s < stateCount; s++) {
+      OutBegin[s] = (uint32_t)Outputs.size();
+      Outputs.insert(Outputs.end(), own[s].begin(), own[s].end());
+    }
+    OutBegin[stateCount] = (uint32_t)Outputs.size();
+  }
+
+  // Appends the id of every pattern found in text; a pattern that occurs
+  // several times is reported several times.
+  void Scan(std::string_view text, std::vector<int32_t> &hits) const {
+    if (Next.empty())
+      return;
+    int32_t state = 0;
+    for (char ch : text) {
+      state = Next[state * ClassCount + ByteClass[(uint8_t)ch]];
+      uint32_t begin = OutBegin[state], end = OutBegin[state + 1];
+      for (uint32_t o = begin; o < end; o++)
+        hits.push_back(Outputs[o]);
+    }
+  }
+
+  size_t StateCount() const {
+    return OutBegin.empty() ? 0 : OutBegin.size() - 1;
+  }
+
+  size_t MemoryUsage() const {
+    return Next.size() * sizeof(int32_t) + OutBegin.size() * sizeof(uint32_t) +
+           Outputs.size() * sizeof(int32_t);
+  }
+};
@@ -1,59 +1,48 @@
 #pragma once
-#include <array>
+#include "BackgroundAnalysis.hpp"
+#include "ChildProcess.hpp"
+#include "LintCache.hpp"
+#include "Luacheck.hpp"
+#include "LuacheckHostPool.hpp"
+#include "ProjectLint.hpp"
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <regex>
-#include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
-
 namespace fs = std::filesystem;
 
-struct LintResult {
-  std::string file;
-  int line;
-  int startCol;
-  int endCol;
-  std::string type;
-  std::string message;
-};
-
-struct PipeCloser {
-  void operator()(FILE *f) const {
-    if (f) {
-#ifdef _WIN32
-      _pclose(f);
-#else
-      pclose(f);
-#endif
-    }
-  }
+// latency of single document lints, as seen by the editor
+struct LintTiming {
+  uint64_t count = 0;     // completed
+  uint64_t cancelled = 0; // killed because a newer request came in
+  uint64_t cached = 0;    // answered from the lint cache
+  double lastMs = 0.0;
+  double avgMs = 0.0;
+  double maxMs = 0.0;
+  bool pooled = false; // last lint was answered by a persistent host
 };
 
 class AsyncLuaLinter {
   struct LintRequest {
     std::string filePath;
     std::string content;
-    bool ready = false;
-    bool isFolder = false;
+    uint64_t seq = 0;      // order of the first request, kept on coalescing
+    bool priority = false; // active tab, goes first
   };
 
   struct LintResponse {
     std::string reqPath;
     std::vector<LintResult> results;
-    bool isFolderResult = false;
   };
 
   std::thread workerThread;
@@ -61,96 +50,94 @@ class AsyncLuaLinter {
   std::condition_variable cv;
 
   std::mutex resultsMutex;
-  std::vector<LintResponse> pendingResults;
+  std::deque<LintResponse> pendingResults;
 
-  LintRequest currentRequest;
+  // at most one waiting request per document, the newest content wins
+  std::unordered_map<std::string, LintRequest> queuedRequests;
+  uint64_t requestSeq = 0;
   std::atomic<bool> running{true};
-  std::atomic<bool> hasWork{false};
   std::atomic<bool> isWorking{false};
 
-  std::string configPath;
-
-  static std::string ExecuteCommand(const char *cmd) {
-    std::string result;
-
-#ifdef _WIN32
-    // --- WINDOWS (CreateProcess + Pipes) ---
-    SECURITY_ATTRIBUTES saAttr;
-    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
-    saAttr.bInheritHandle = TRUE;
-    saAttr.lpSecurityDescriptor = NULL;
-
-    HANDLE hChildStd_OUT_Rd = NULL;
-    HANDLE hChildStd_OUT_Wr = NULL;
-
-    if (!CreatePipe(&hChildStd_OUT_Rd, &hChildStd_OUT_Wr, &saAttr, 0)) {
-      return "";
+  // the lint being run right now, so a newer request can abort it
+  std::string inFlightPath;
+  std::shared_ptr<ProcessCancel> inFlightCancel;
+
+  // priority requests first, otherwise in the order documents asked
+  LintRequest TakeNext() {
+    auto best = queuedRequests.begin();
+    for (auto it = queuedRequests.begin(); it != queuedRequests.end(); ++it) {
+      const LintRequest &r = it->second;
+      if (r.priority != best->second.priority
+              ? r.priority
+              : r.seq < best->second.seq)
+        best = it;
     }
+    LintRequest req = std::move(best->second);
+    queuedRequests.erase(best);
+    return req;
+  }
 
-    SetHandleInformation(hChildStd_OUT_Rd, HANDLE_FLAG_INHERIT, 0);
-
-    STARTUPINFOA si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.hStdError = hChildStd_OUT_Wr;
-    si.hStdOutput = hChildStd_OUT_Wr;
-    si.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-
-    ZeroMemory(&pi, sizeof(pi));
-
-    std::string cmdStr = std::string("cmd.exe /C ") + cmd;
-    std::vector<char> cmdMutable(cmdStr.begin(), cmdStr.end());
-    cmdMutable.push_back(0);
-
-    BOOL bSuccess = CreateProcessA(NULL,
-                                   cmdMutable.data(), // command line
-                                   NULL, // process security attributes
-                                   NULL, // primary thread security attributes
-                                   TRUE, // handles are inherited
-                                   CREATE_NO_WINDOW, // don't create window
-                                   NULL,             // use parent's environment
-                                   NULL, // use parent's current directory
-                                   &si,  // STARTUPINFO pointer
-                                   &pi); // receives PROCESS_INFORMATION
-
-    CloseHandle(hChildStd_OUT_Wr);
-
-    if (bSuccess) {
-      DWORD dwRead;
-      CHAR chBuf[4096];
-      bool bSuccessRead = FALSE;
+  std::string configPath;
+  LintCache lintCache; // shared with projectLint, so declared before it
+
+  // one host per core, started only as they are needed
+  LuacheckHostPool hostPool{std::max(2u, std::thread::hardware_concurrency())};
+  ProjectLint projectLint{&hostPool, &lintCache};
+  ProjectLint relint{&hostPool, &lintCache}; // files whose globals changed
+  BackgroundAnalysis background{&lintCache};
+  std::mutex timingMutex;
+  LintTiming timing;
+
+  void RecordTiming(std::chrono::steady_clock::time_point start,
+                    bool pooled) {
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    std::lock_guard<std::mutex> lock(timingMutex);
+    timing.count++;
+    timing.lastMs = ms;
+    timing.avgMs += (ms - timing.avgMs) / (double)timing.count;
+    timing.maxMs = std::max(timing.maxMs, ms);
+    timing.pooled = pooled;
+  }
 
-      while (true) {
-        bSuccessRead = ReadFile(hChildStd_OUT_Rd, chBuf, 4096, &dwRead, NULL);
-        if (!bSuccessRead || dwRead == 0)
-          break;
-        result.append(chBuf, dwRead);
-      }
-      WaitForSingleObject(pi.hProcess, 1000);
-      CloseHandle(pi.hProcess);
-      CloseHandle(pi.hThread);
+  // false when there is nothing to report: a newer request cancelled it,
+  // or luacheck could not check the file (the editor's own pass stands)
+  bool Lint(const LintRequest &req, ProcessCancel *cancel,
+            std::vector<LintResult> &results, uint64_t key) {
+    // piped in and reported under its real path
+    std::string output;
+    int exitCode = 0;
+    auto start = std::chrono::steady_clock::now();
+    bool pooled = hostPool.Lint(req.filePath, req.content, configPath,
+                                output, cancel);
+    bool started = pooled || cancel->IsCancelled();
+    if (!started) {
+      started = ChildProcess::Run(
+          Luacheck::Args({"-", "--filename", req.filePath}, configPath),
+          req.content, output, &exitCode, cancel);
+      if (!started)
+        std::cout << "[Linter] Failed to start process!" << std::endl;
     }
 
-    CloseHandle(hChildStd_OUT_Rd);
-
-#else
-    // --- LINUX/MACOS (popen) ---
-    std::array<char, 256> buffer;
-    std::unique_ptr<FILE, PipeCloser> pipe(popen(cmd, "r"));
-
-    if (!pipe) {
-      std::cout << "[Linter] Failed to start process!" << std::endl;
-      return "";
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      inFlightPath.clear();
+      inFlightCancel.reset();
     }
-
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-      result += buffer.data();
+    if (cancel->IsCancelled()) {
+      std::lock_guard<std::mutex> lock(timingMutex);
+      timing.cancelled++;
+      return false;
     }
-#endif
+    // 0-2 is luacheck having checked the file, anything else is a failure
+    if (!pooled && (!started || exitCode < 0 || exitCode > 2))
+      return false;
+    RecordTiming(start, pooled);
 
-    return result;
+    Luacheck::Parse(output, req.filePath, results);
+    lintCache.Store(key, results);
+    return true;
   }
 
   void WorkerLoop() {
@@ -158,73 +145,29 @@ class AsyncLuaLinter {
       LintRequest req;
       {
         std::unique_lock<std::mutex> lock(queueMutex);
-        cv.wait(lock, [this] { return hasWork || !running; });
+        cv.wait(lock,
+                [this] { return !queuedRequests.empty() || !running; });
         if (!running)
           break;
-        req = currentRequest;
-        hasWork = false;
-        currentRequest.ready = false;
+        req = TakeNext();
         isWorking = true;
       }
 
-      if (!req.ready) {
-        isWorking = false;
-        continue;
-      }
-
-      std::string cmd;
-      std::string targetPath = req.filePath;
-      bool useTemp = !req.isFolder;
-
-      if (useTemp) {
-        targetPath = req.filePath + ".tmp_lint";
-        {
-          std::ofstream out(targetPath);
-          out << req.content;
-        }
-      }
-
-      cmd = "luacheck \"" + targetPath +
-            "\" --no-color --formatter=plain --ranges --codes";
-
-      if (!configPath.empty()) {
-        cmd += " --config \"" + configPath + "\"";
-      }
-
-      std::string output = ExecuteCommand(cmd.c_str());
-
       std::vector<LintResult> results;
-      std::regex re(
-          R"(^(.+):(\d+):(\d+)-(\d+):\s+(?:(?:\(([WE])\d+\)\s+)|)(.*)$)");
-      std::smatch match;
-      std::stringstream ss(output);
-      std::string line;
-
-      while (std::getline(ss, line)) {
-        if (!line.empty() && line.back() == '\r')
-          line.pop_back();
-        if (std::regex_search(line, match, re)) {
-          LintResult res;
-
-          if (req.isFolder) {
-            res.file = match[1];
-          } else {
-            res.file = req.filePath;
-          }
-
-          res.line = std::stoi(match[2]);
-          res.startCol = std::stoi(match[3]);
-          res.endCol = std::stoi(match[4]);
-          res.type = match[5].matched ? match[5].str() : "W";
-          res.message = match[6];
-          results.push_back(res);
+      uint64_t key = lintCache.Key(req.filePath, req.content);
+      if (lintCache.Get(key, req.filePath, results)) {
+        std::lock_guard<std::mutex> lock(timingMutex);
+        timing.cached++;
+      } else {
+        auto cancel = std::make_shared<ProcessCancel>();
+        {
+          std::lock_guard<std::mutex> lock(queueMutex);
+          inFlightPath = req.filePath;
+          inFlightCancel = cancel;
         }
-      }
-
-      if (useTemp) {
-        try {
-          fs::remove(targetPath);
-        } catch (...) {
+        if (!Lint(req, cancel.get(), results, key)) {
+          isWorking = false;
+          continue;
         }
       }
 
@@ -232,9 +175,8 @@ class AsyncLuaLinter {
         std::lock_guard<std::mutex> lock(resultsMutex);
         LintResponse resp;
         resp.reqPath = req.filePath;
-        resp.results = results;
-        resp.isFolderResult = req.isFolder;
-        pendingResults.push_back(resp);
+        resp.results = std::move(results);
+        pendingResults.push_back(std::move(resp));
       }
 
       isWorking = false;
@@ -253,45 +195,102 @@ public:
       workerThread.join();
   }
 
-  void SetConfigPath(const std::string &path) { configPath = path; }
+  // the lint cache lives beside the scripts root the config sits in
+  void SetConfigPath(const std::string &path) {
+    configPath = path;
+    lintCache.Save();
+    lintCache.Open(
+        (fs::path(path).parent_path().parent_path() / ".secondaid_lintcache")
+            .string(),
+        path);
+  }
 
-  void RequestLint(const std::string &filePath, const std::string &content) {
+  // Queues a lint of content for filePath. A request still waiting for
+  // the same file is replaced, keeping its place in the queue, and one
+  // already running for it is killed since its result would be stale.
+  void RequestLint(const std::string &filePath, const std::string &content,
+                   bool priority = false) {
     {
       std::lock_guard<std::mutex> lock(queueMutex);
-      currentRequest.filePath = filePath;
-      currentRequest.content = content;
-      currentRequest.isFolder = false;
-      currentRequest.ready = true;
-      hasWork = true;
+      auto [it, added] = queuedRequests.try_emplace(filePath);
+      LintRequest &req = it->second;
+      if (added) {
+        req.filePath = filePath;
+        req.seq = requestSeq++;
+      }
+      req.content = content;
+      req.priority = req.priority || priority;
+      if (inFlightCancel && inFlightPath == filePath)
+        inFlightCancel->Cancel();
     }
     cv.notify_one();
   }
 
+  // lints every script under folderPath in parallel, see ProjectLint
   void RequestFolderScan(const std::string &folderPath) {
-    {
-      std::lock_guard<std::mutex> lock(queueMutex);
-      currentRequest.filePath = folderPath;
-      currentRequest.content = "";
-      currentRequest.isFolder = true;
-      currentRequest.ready = true;
-      hasWork = true;
-    }
-    cv.notify_one();
+    projectLint.Start(folderPath, configPath);
+  }
+  void CancelFolderScan() { projectLint.Cancel(); }
+  bool IsFolderScanRunning() const { return projectLint.IsRunning(); }
+  bool WasFolderScanCancelled() const { return projectLint.WasCancelled(); }
+  size_t FolderScanDone() const { return projectLint.FilesDone(); }
+  size_t FolderScanTotal() const { return projectLint.FilesTotal(); }
+  size_t FolderScanCached() const { return projectLint.FilesCached(); }
+  void CollectFolderResults(std::vector<LintResult> &out) {
+    projectLint.Collect(out);
+  }
+
+  // lints just these files, next to (not instead of) a folder scan
+  void RequestRelint(std::vector<std::string> files) {
+    relint.StartFiles(std::move(files), configPath);
+  }
+  bool IsRelintRunning() const { return relint.IsRunning(); }
+  void CollectRelintResults(std::vector<LintResult> &out) {
+    relint.Collect(out);
+  }
+
+  // continuous analysis of the folder, see BackgroundAnalysis
+  void StartBackground(const std::string &folderPath) {
+    background.Start(folderPath, configPath);
+  }
+  void StopBackground() { background.Stop(); }
+  void SetBackgroundFallback(LuaLint::Options options) {
+    background.SetFallback(std::move(options));
+  }
+  void SetBackgroundPace(BackgroundAnalysis::Pace pace) {
+    background.SetPace(pace);
+  }
+  void PrioritizeInBackground(const std::vector<std::string> &files) {
+    background.Prioritize(files);
+  }
+  void PrioritizeBufferInBackground(const std::string &file,
+                                    const std::string &content) {
+    background.PrioritizeBuffer(file, content);
+  }
+  void CollectBackgroundUpdates(std::vector<BackgroundAnalysis::Update> &out) {
+    background.Collect(out);
+  }
+  BackgroundAnalysis::Status GetBackgroundStatus() {
+    return background.GetStatus();
   }
 
   bool IsScanning() const { return isWorking; }
 
-  bool GetResult(std::string &outReqID, std::vector<LintResult> &outResults,
-                 bool &outIsFolder) {
+  LintTiming GetTiming() {
+    std::lock_guard<std::mutex> lock(timingMutex);
+    return timing;
+  }
+
+  // oldest finished lint first; call until it returns false
+  bool GetResult(std::string &outReqID, std::vector<LintResult> &outResults) {
     std::lock_guard<std::mutex> lock(resultsMutex);
     if (pendingResults.empty())
       return false;
 
-    auto &item = pendingResults.back();
-    outReqID = item.reqPath;
-    outResults = item.results;
-    outIsFolder = item.isFolderResult;
-    pendingResults.clear();
+    auto &item = pendingResults.front();
+    outReqID = std::move(item.reqPath);
+    outResults = std::move(item.results);
+    pendingResults.pop_front();
     return true;
   }
 };
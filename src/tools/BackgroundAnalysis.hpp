@@ -0,0 +1,423 @@
+#pragma once
+#include "LintCache.hpp"
+#include "LuaLint.hpp"
+#include "Luacheck.hpp"
+#include "LuacheckHostPool.hpp"
+#include "ProjectLint.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+// Keeps project-wide lint results current without being asked: one low
+// priority thread sweeps the scripts folder round-robin, re-linting files
+// whose mtime or size changed since it last looked (all of them when the
+// config's settings do), and takes urgent files (just saved, open buffers,
+// users of changed globals) first.
+// Results come out as per-file replacements. How fast it goes is set
+// by the UI every frame. Without luacheck the built-in checks stand in.
+class BackgroundAnalysis {
+public:
+  enum class Pace {
+    Full,   // idle UI, lint back to back
+    Gentle, // UI busy, a pause after every lint
+    Paused  // e.g. debugger stopped, no work at all
+  };
+
+  // results replacing everything known about file so far
+  struct Update {
+    std::string file;
+    std::vector<LintResult> results;
+  };
+
+  struct Status {
+    size_t swept = 0, total = 0; // position in the current pass
+    uint64_t linted = 0;         // files actually linted, all time
+    bool running = false;
+    bool builtin = false; // luacheck not found, built-in checks only
+  };
+
+private:
+  struct Job {
+    std::string file;
+    std::string content;
+    bool fromBuffer = false;
+  };
+
+  struct FileState {
+    std::filesystem::file_time_type mtime;
+    uintmax_t size = 0;
+    bool builtin = false;
+  };
+
+  static constexpr auto PassInterval = std::chrono::seconds(2);
+  static constexpr auto GentleDelay = std::chrono::milliseconds(50);
+
+  // own host, started by (and as low priority as) the sweeping thread
+  LuacheckHostPool Pool{1};
+  LintCache *Cache;
+  std::string Root;
+  std::string ConfigPath;
+
+  std::thread Worker;
+  std::mutex Mutex;
+  std::condition_variable Cv;
+  bool Running = false;
+  Pace CurrentPace = Pace::Full;
+  std::deque<Job> Urgent;
+  std::vector<Update> Updates;
+  Status Progress;
+  std::shared_ptr<const LuaLint::Options> Fallback;
+
+  // sweep state, touched by the worker only
+  std::vector<std::string> Files;
+  size_t Cursor = 0;
+  std::unordered_map<std::string, FileState> States;
+  // luacheck failed with the config it has now, so it's not tried again
+  // before that changes or the sweep is restarted
+  bool NoLuacheck = false;
+  uint64_t NoLuacheckConfig = 0;
+  bool HaveBuiltin = false; // States has files the built-in pass did
+  std::filesystem::file_time_type ConfigTime;
+  uint64_t Settings = 0;
+
+  static void LowerPriority() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+    // niceness is per thread on Linux, and luacheck started from here
+    // inherits it
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+  }
+
+  // one spelling per file, however the editor or the walk named it
+  static std::string Normalize(const std::string &path) {
+    std::error_code ec;
+    std::filesystem::path p = std::filesystem::absolute(path, ec);
+    return (ec ? std::filesystem::path(path) : p)
+        .lexically_normal()
+        .make_preferred()
+        .string();
+  }
+
+  void Publish(const std::string &file, std::vector<LintResult> results) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Updates.push_back({file, std::move(results)});
+    Progress.linted++;
+  }
+
+  // files added since the last pass are picked up, deleted ones dropped
+  void RefreshFiles() {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(Root, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+      if (it->is_regular_file(ec) && it->path().extension() == ".lua")
+        files.push_back(Normalize(it->path().string()));
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto &old : Files) {
+      if (!std::binary_search(files.begin(), files.end(), old)) {
+        States.erase(old);
+        Publish(old, {});
+      }
+    }
+    Files = std::move(files);
+    Cursor = 0;
+    std::lock_guard<std::mutex> lock(Mutex);
+    Progress.swept = 0;
+    Progress.total = Files.size();
+  }
+
+  // Hash of the config without the project's globals. Those change with
+  // most saves and RelintDependents already queues the files using them;
+  // anything else may change every file's results.
+  uint64_t SettingsVersion() {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(ConfigPath, ec);
+    if (ec || mtime == ConfigTime)
+      return ec ? 0 : Settings;
+    ConfigTime = mtime;
+    std::ifstream file(ConfigPath, std::ios::binary);
+    uint64_t h = 14695981039346656037ull;
+    bool globals = false;
+    std::string line;
+    while (std::getline(file, line)) {
+      // as GlobalsManager::GenerateConfig lays it out
+      if (line.find("-- DYNAMIC GLOBALS --") != std::string::npos)
+        globals = true;
+      else if (globals && line == "}")
+        globals = false;
+      if (globals)
+        continue;
+      line += '\n';
+      for (unsigned char c : line) {
+        h ^= c;
+        h *= 1099511628211ull;
+      }
+    }
+    return h;
+  }
+
+  // false when nothing changed since the file was last linted
+  bool Sweep(const std::string &file, uint64_t config) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(file, ec);
+    uintmax_t size = std::filesystem::file_size(file, ec);
+    if (ec)
+      return false;
+    auto it = States.find(file);
+    if (it != States.end() && it->second.mtime == mtime &&
+        it->second.size == size)
+      return false;
+    std::string content;
+    if (!ReadWhole(file, content))
+      return false;
+    std::vector<LintResult> results;
+    bool builtin;
+    if (!LintContent(file, content, config, results, builtin))
+      return false;
+    States[file] = {mtime, size, builtin};
+    Publish(file, std::move(results));
+    return true;
+  }
+
+  // luacheck's results, or the built-in pass's while there is no luacheck
+  bool LintContent(const std::string &file, const std::string &content,
+                   uint64_t config, std::vector<LintResult> &results,
+                   bool &builtin) {
+    if (NoLuacheck && config != NoLuacheckConfig)
+      NoLuacheck = false; // maybe it was the config, give it another go
+    if (!NoLuacheck &&
+        ProjectLint::LintSource(&Pool, Cache, file, content, ConfigPath,
+                                results)) {
+      if (HaveBuiltin) {
+        // it's back, what the built-in pass did is done again
+        for (auto it = States.begin(); it != States.end();)
+          it = it->second.builtin ? States.erase(it) : std::next(it);
+        HaveBuiltin = false;
+        std::lock_guard<std::mutex> lock(Mutex);
+        Progress.builtin = false;
+      }
+      builtin = false;
+      return true;
+    }
+    results.clear();
+    NoLuacheck = true;
+    NoLuacheckConfig = config;
+    std::shared_ptr<const LuaLint::Options> options;
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      options = Fallback;
+      if (options)
+        Progress.builtin = true;
+    }
+    if (!options)
+      return false;
+    LuaLint::Check(content, file, *options, results);
+    HaveBuiltin = builtin = true;
+    return true;
+  }
+
+  static bool ReadWhole(const std::string &path, std::string &out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      return false;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    out = ss.str();
+    return true;
+  }
+
+  void Lint(const Job &job, uint64_t config) {
+    if (!job.fromBuffer) {
+      States.erase(job.file); // forces the lint
+      Sweep(job.file, config);
+      return;
+    }
+    std::vector<LintResult> results;
+    bool builtin;
+    if (LintContent(job.file, job.content, config, results, builtin)) {
+      // stands until the file changes on disk or is queued again
+      std::error_code ec;
+      FileState state;
+      state.mtime = std::filesystem::last_write_time(job.file, ec);
+      state.size = std::filesystem::file_size(job.file, ec);
+      state.builtin = builtin;
+      States[job.file] = state;
+      Publish(job.file, std::move(results));
+    }
+  }
+
+  void Loop() {
+    LowerPriority();
+    auto nextPass = std::chrono::steady_clock::now();
+    while (true) {
+      Job job;
+      bool urgent = false, sweep = false;
+      Pace pace;
+      {
+        std::unique_lock<std::mutex> lock(Mutex);
+        while (Running) {
+          if (CurrentPace != Pace::Paused) {
+            if (!Urgent.empty()) {
+              job = std::move(Urgent.front());
+              Urgent.pop_front();
+              urgent = true;
+              break;
+            }
+            if (Cursor < Files.size() ||
+                std::chrono::steady_clock::now() >= nextPass)
+              break;
+            Cv.wait_until(lock, nextPass);
+          } else {
+            Cv.wait(lock);
+          }
+        }
+        if (!Running)
+          return;
+        pace = CurrentPace;
+        if (!urgent && Cursor < Files.size()) {
+          job.file = Files[Cursor++];
+          Progress.swept = Cursor;
+          sweep = true;
+        }
+      }
+
+      // the config is rewritten on every save, only new content counts
+      uint64_t config = Cache ? Cache->ConfigVersion() : 0;
+      uint64_t settings = SettingsVersion();
+      if (settings != Settings) {
+        Settings = settings;
+        States.clear();
+      }
+      bool linted = false;
+      if (urgent) {
+        Lint(job, config);
+        linted = true;
+      } else if (sweep) {
+        linted = Sweep(job.file, config);
+      } else {
+        RefreshFiles();
+        nextPass = std::chrono::steady_clock::now() + PassInterval;
+      }
+
+      if (linted && pace == Pace::Gentle) {
+        std::unique_lock<std::mutex> lock(Mutex);
+        Cv.wait_for(lock, GentleDelay, [this] { return !Running; });
+      }
+    }
+  }
+
+public:
+  explicit BackgroundAnalysis(LintCache *cache) : Cache(cache) {}
+  ~BackgroundAnalysis() { Stop(); }
+
+  void Start(const std::string &root, const std::string &configPath) {
+    Stop();
+    Root = root;
+    ConfigPath = configPath;
+    Files.clear();
+    Cursor = 0;
+    States.clear();
+    NoLuacheck = HaveBuiltin = false;
+    ConfigTime = {};
+    Settings = 0;
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Running = true;
+      Progress = Status();
+      Progress.running = true;
+    }
+    Worker = std::thread(&BackgroundAnalysis::Loop, this);
+  }
+
+  // the current file is finished first; results not collected are kept
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Running = false;
+      Progress.running = false;
+    }
+    Cv.notify_all();
+    if (Worker.joinable())
+      Worker.join();
+  }
+
+  void SetPace(Pace pace) {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      if (pace == CurrentPace)
+        return;
+      CurrentPace = pace;
+    }
+    Cv.notify_all();
+  }
+
+  // what the built-in checks use when luacheck can't be run; called from
+  // the UI thread, so nothing in options may point back into it
+  void SetFallback(LuaLint::Options options) {
+    auto shared = std::make_shared<const LuaLint::Options>(std::move(options));
+    std::lock_guard<std::mutex> lock(Mutex);
+    Fallback = std::move(shared);
+  }
+
+  // re-lints these from disk before anything else
+  void Prioritize(const std::vector<std::string> &files) {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      for (const auto &file : files)
+        Urgent.push_back({Normalize(file), "", false});
+    }
+    Cv.notify_all();
+  }
+
+  // Lints an open buffer in place of the file on disk. A buffer already
+  // waiting for the same file is replaced.
+  void PrioritizeBuffer(const std::string &file, const std::string &content) {
+    std::string key = Normalize(file);
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      auto it = std::find_if(Urgent.begin(), Urgent.end(), [&](const Job &j) {
+        return j.fromBuffer && j.file == key;
+      });
+      if (it != Urgent.end())
+        it->content = content;
+      else
+        Urgent.push_back({key, content, true});
+    }
+    Cv.notify_all();
+  }
+
+  // moves the updates since the last call to the end of out, oldest first
+  void Collect(std::vector<Update> &out) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    out.insert(out.end(), std::make_move_iterator(Updates.begin()),
+               std::make_move_iterator(Updates.end()));
+    Updates.clear();
+  }
+
+  Status GetStatus() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Progress;
+  }
+};
@@ -0,0 +1,414 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
+
+// A child process with its stdin and stdout (stderr merged in) connected
+// to pipes, so a tool can be fed from memory and its output read back
+// without going through files. Arguments are passed as a list, nothing is
+// interpreted by a shell on POSIX.
+class ProcessCancel;
+
+class ChildProcess {
+#ifdef _WIN32
+  HANDLE Process = NULL;
+  HANDLE Job = NULL; // takes cmd.exe's children down with it on Kill()
+  HANDLE InputWr = NULL;
+  HANDLE OutputRd = NULL;
+
+  // quoting understood by the MSVC runtime's argv parser
+  static std::string Quote(const std::string &arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos)
+      return arg;
+    std::string out = "\"";
+    size_t slashes = 0;
+    for (char c : arg) {
+      if (c == '\\') {
+        slashes++;
+        continue;
+      }
+      out.append(c == '"' ? slashes * 2 + 1 : slashes, '\\');
+      slashes = 0;
+      out += c;
+    }
+    out.append(slashes * 2, '\\');
+    return out + "\"";
+  }
+#else
+  pid_t Pid = -1;
+  int InputWr = -1;
+  int OutputRd = -1;
+
+  static bool Pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0)
+      return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+  }
+
+#ifndef __linux__
+  // without pipe2, spawns wait for each other so none can happen between
+  // another one's pipe() and fcntl()
+  static std::mutex &SpawnMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+#endif
+#endif
+
+public:
+  ChildProcess() = default;
+  ChildProcess(const ChildProcess &) = delete;
+  ChildProcess &operator=(const ChildProcess &) = delete;
+  ~ChildProcess() {
+    CloseInput();
+    Kill();
+    Wait();
+  }
+
+  bool Start(const std::vector<std::string> &args) {
+    if (args.empty())
+      return false;
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+    HANDLE inRd = NULL, inWr = NULL, outRd = NULL, outWr = NULL;
+    if (!CreatePipe(&inRd, &inWr, &sa, 0))
+      return false;
+    if (!CreatePipe(&outRd, &outWr, &sa, 0)) {
+      CloseHandle(inRd);
+      CloseHandle(inWr);
+      return false;
+    }
+    // our ends must not be inherited, or the child never sees EOF
+    SetHandleInformation(inWr, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(outRd, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOEXA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    ZeroMemory(&pi, sizeof(pi));
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.hStdInput = inRd;
+    si.StartupInfo.hStdOutput = outWr;
+    si.StartupInfo.hStdError = outWr;
+    si.StartupInfo.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    si.StartupInfo.wShowWindow = SW_HIDE;
+
+    // Only this child's ends are inherited. Without the list it would get
+    // every inheritable handle in the process, including the pipe ends of
+    // children other threads are starting right now, and those would then
+    // never see EOF while this one lives.
+    HANDLE inherit[] = {inRd, outWr};
+    SIZE_T attrSize = 0;
+    InitializeProcThreadAttributeList(NULL, 1, 0, &attrSize);
+    std::vector<char> attrBuf(attrSize);
+    auto attrs = (LPPROC_THREAD_ATTRIBUTE_LIST)attrBuf.data();
+    bool haveList =
+        InitializeProcThreadAttributeList(attrs, 1, 0, &attrSize) &&
+        UpdateProcThreadAttribute(attrs, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                                  inherit, sizeof(inherit), NULL, NULL);
+    if (haveList)
+      si.lpAttributeList = attrs;
+
+    // through cmd.exe so .bat/.cmd wrappers on PATH resolve as before;
+    // /S makes it strip exactly the outer pair of quotes
+    std::string cmdLine = "cmd.exe /S /C \"";
+    for (size_t i = 0; i < args.size(); i++)
+      cmdLine += (i ? " " : "") + Quote(args[i]);
+    cmdLine += "\"";
+    std::vector<char> cmdMutable(cmdLine.begin(), cmdLine.end());
+    cmdMutable.push_back(0);
+
+    DWORD flags = CREATE_NO_WINDOW | CREATE_SUSPENDED;
+    if (haveList)
+      flags |= EXTENDED_STARTUPINFO_PRESENT;
+    BOOL ok = CreateProcessA(NULL, cmdMutable.data(), NULL, NULL, TRUE, flags,
+                             NULL, NULL, &si.StartupInfo, &pi);
+    if (haveList)
+      DeleteProcThreadAttributeList(attrs);
+    CloseHandle(inRd);
+    CloseHandle(outWr);
+    if (!ok) {
+      CloseHandle(inWr);
+      CloseHandle(outRd);
+      return false;
+    }
+    Job = CreateJobObjectA(NULL, NULL);
+    if (Job) {
+      JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+      ZeroMemory(&limits, sizeof(limits));
+      limits.BasicLimitInformation.LimitFlags =
+          JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+      SetInformationJobObject(Job, JobObjectExtendedLimitInformation,
+                              &limits, sizeof(limits));
+      if (!AssignProcessToJobObject(Job, pi.hProcess)) {
+        CloseHandle(Job);
+        Job = NULL;
+      }
+    }
+    ResumeThread(pi.hThread);
+    CloseHandle(pi.hThread);
+    Process = pi.hProcess;
+    InputWr = inWr;
+    OutputRd = outRd;
+    return true;
+#else
+    // a child that exits before reading all its input must not take us
+    // down with it; the failed write is reported instead
+    static const bool ignoreSigpipe = (signal(SIGPIPE, SIG_IGN), true);
+    (void)ignoreSigpipe;
+
+    // All four ends are close-on-exec from the start, so none of them leak
+    // into a child another thread spawns meanwhile (a host holding some
+    // other child's stdout would keep that one's reader from seeing EOF).
+    // The dup2 onto 0/1/2 below clears the flag on the child's copies.
+#ifndef __linux__
+    std::lock_guard<std::mutex> spawnLock(SpawnMutex());
+#endif
+    int in[2], out[2];
+    if (!Pipe(in))
+      return false;
+    if (!Pipe(out)) {
+      close(in[0]);
+      close(in[1]);
+      return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, in[0]);
+    posix_spawn_file_actions_addclose(&actions, out[1]);
+
+    std::vector<char *> argv;
+    for (const auto &arg : args)
+      argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    // own process group, so Kill() also reaches anything a wrapper
+    // script started
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    int err = posix_spawnp(&Pid, argv[0], &actions, &attr, argv.data(),
+                           environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    close(out[1]);
+    if (err != 0) {
+      Pid = -1;
+      close(in[1]);
+      close(out[0]);
+      return false;
+    }
+    InputWr = in[1];
+    OutputRd = out[0];
+    return true;
+#endif
+  }
+
+  bool Write(const char *data, size_t size) {
+#ifdef _WIN32
+    while (size > 0 && InputWr) {
+      DWORD written = 0;
+      DWORD chunk = (DWORD)std::min<size_t>(size, 1 << 20);
+      if (!WriteFile(InputWr, data, chunk, &written, NULL))
+        return false;
+      data += written;
+      size -= written;
+    }
+    return size == 0;
+#else
+    while (size > 0 && InputWr >= 0) {
+      ssize_t n = write(InputWr, data, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      data += n;
+      size -= (size_t)n;
+    }
+    return size == 0;
+#endif
+  }
+
+  // the child sees EOF on stdin
+  void CloseInput() {
+#ifdef _WIN32
+    if (InputWr)
+      CloseHandle(InputWr);
+    InputWr = NULL;
+#else
+    if (InputWr >= 0)
+      close(InputWr);
+    InputWr = -1;
+#endif
+  }
+
+  // blocks until output arrives; 0 once the child closed its stdout
+  size_t Read(char *buf, size_t size) {
+#ifdef _WIN32
+    DWORD n = 0;
+    if (!OutputRd || !ReadFile(OutputRd, buf, (DWORD)size, &n, NULL))
+      return 0;
+    return n;
+#else
+    if (OutputRd < 0)
+      return 0;
+    ssize_t n;
+    do {
+      n = read(OutputRd, buf, size);
+    } while (n < 0 && errno == EINTR);
+    return n > 0 ? (size_t)n : 0;
+#endif
+  }
+
+  void Kill() {
+#ifdef _WIN32
+    if (Job)
+      TerminateJobObject(Job, 1);
+    else if (Process)
+      TerminateProcess(Process, 1);
+#else
+    if (Pid > 0)
+      kill(-Pid, SIGKILL);
+#endif
+  }
+
+  // reaps the child and closes the pipes; exit code, or -1 when unknown
+  int Wait() {
+    int code = -1;
+#ifdef _WIN32
+    if (Process) {
+      WaitForSingleObject(Process, INFINITE);
+      DWORD exitCode;
+      if (GetExitCodeProcess(Process, &exitCode))
+        code = (int)exitCode;
+      CloseHandle(Process);
+      Process = NULL;
+    }
+    if (Job)
+      CloseHandle(Job);
+    Job = NULL;
+    if (OutputRd)
+      CloseHandle(OutputRd);
+    OutputRd = NULL;
+#else
+    if (Pid > 0) {
+      int status = 0;
+      pid_t r;
+      do {
+        r = waitpid(Pid, &status, 0);
+      } while (r < 0 && errno == EINTR);
+      if (r == Pid && WIFEXITED(status))
+        code = WEXITSTATUS(status);
+      Pid = -1;
+    }
+    if (OutputRd >= 0)
+      close(OutputRd);
+    OutputRd = -1;
+#endif
+    CloseInput();
+    return code;
+  }
+
+  // Runs args to completion with input on its stdin. Input is written from
+  // a second thread while output is drained here, so neither pipe can fill
+  // up and stall the other side. False if the process could not start.
+  // With cancel, another thread can kill the process midway.
+  static bool Run(const std::vector<std::string> &args,
+                  const std::string &input, std::string &output,
+                  int *exitCode = nullptr, ProcessCancel *cancel = nullptr);
+};
+
+// Lets another thread abort whatever child process a job is currently
+// running. The job attaches its process for as long as it talks to it;
+// Cancel() kills it and makes any later Attach() fail.
+class ProcessCancel {
+  std::mutex Mutex;
+  ChildProcess *Proc = nullptr;
+  bool Cancelled = false;
+
+public:
+  bool Attach(ChildProcess *proc) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (Cancelled)
+      return false;
+    Proc = proc;
+    return true;
+  }
+
+  // must come before the process is reaped with Wait()
+  void Detach() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Proc = nullptr;
+  }
+
+  void Cancel() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Cancelled = true;
+    if (Proc)
+      Proc->Kill();
+  }
+
+  bool IsCancelled() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Cancelled;
+  }
+};
+
+inline bool ChildProcess::Run(const std::vector<std::string> &args,
+                              const std::string &input, std::string &output,
+                              int *exitCode, ProcessCancel *cancel) {
+  ChildProcess proc;
+  if (!proc.Start(args))
+    return false;
+  if (cancel && !cancel->Attach(&proc))
+    proc.Kill();
+  std::thread writer;
+  if (input.empty())
+    proc.CloseInput();
+  else
+    writer = std::thread([&proc, &input] {
+      proc.Write(input.data(), input.size());
+      proc.CloseInput();
+    });
+
+  char buf[4096];
+  size_t n;
+  while ((n = proc.Read(buf, sizeof(buf))) > 0)
+    output.append(buf, n);
+  if (writer.joinable())
+    writer.join();
+  if (cancel)
+    cancel->Detach();
+  int code = proc.Wait();
+  if (exitCode)
+    *exitCode = code;
+  return true;
+}
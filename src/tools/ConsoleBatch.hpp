@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BatchCommand {
+  std::string text;
+  int sourceLine = 0;
+  int64_t sentMs = -1;
+  int64_t firstOutputMs = -1;
+  int64_t lastOutputMs = -1;
+  std::vector<size_t> output; // store indices of the lines it produced
+};
+
+struct BatchSummary {
+  size_t sent = 0;
+  size_t answered = 0;
+  size_t outputLines = 0;
+  int64_t totalMs = 0;
+  double commandsPerSec = 0.0;
+  double latencyAvgMs = 0.0;
+  int64_t latencyP50Ms = 0;
+  int64_t latencyP95Ms = 0;
+  int64_t latencyMaxMs = 0;
+};
+
+// Sends a list of console commands with configurable pacing and attributes
+// the "Console" output that comes back to the command that produced it.
+// The game does not tag replies, so a line belongs to the last command sent
+// before the line was received. With WaitForOutput each command waits for
+// the previous one to go quiet, which makes that exact; without it commands
+// are pipelined every IntervalMs and attribution is by time only.
+//
+// Driven from the UI thread: Update() once per frame, OnOutput() for every
+// new console line.
+class ConsoleBatch {
+  std::vector<BatchCommand> Commands;
+  size_t NextToSend = 0;
+  bool Running = false;
+  int64_t StartedMs = 0;
+  int64_t FinishedMs = 0;
+
+  bool Settled(const BatchCommand &cmd, int64_t nowMs) const {
+    if (cmd.lastOutputMs >= 0 && nowMs - cmd.lastOutputMs >= QuietMs)
+      return true;
+    return nowMs - cmd.sentMs >= TimeoutMs;
+  }
+
+public:
+  int IntervalMs = 50;
+  bool WaitForOutput = false;
+  int QuietMs = 250;    // no more output for this long = command finished
+  int TimeoutMs = 3000; // give up waiting for output
+
+  std::function<void(const std::string &)> Send;
+
+  // one command per line; blank lines and lines starting with '#' or "--"
+  // are skipped
+  size_t Load(const std::string &script) {
+    Stop();
+    Commands.clear();
+    std::istringstream in(script);
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+      lineNo++;
+      size_t b = line.find_first_not_of(" \t\r");
+      if (b == std::string::npos)
+        continue;
+      size_t e = line.find_last_not_of(" \t\r");
+      std::string cmd = line.substr(b, e - b + 1);
+      if (cmd[0] == '#' || cmd.compare(0, 2, "--") == 0)
+        continue;
+      BatchCommand bc;
+      bc.text = std::move(cmd);
+      bc.sourceLine = lineNo;
+      Commands.push_back(std::move(bc));
+    }
+    return Commands.size();
+  }
+
+  void Start(int64_t nowMs) {
+    for (auto &cmd : Commands) {
+      cmd.sentMs = cmd.firstOutputMs = cmd.lastOutputMs = -1;
+      cmd.output.clear();
+    }
+    NextToSend = 0;
+    StartedMs = nowMs;
+    FinishedMs = 0;
+    Running = !Commands.empty();
+  }
+
+  void Stop() { Running = false; }
+
+  bool IsRunning() const { return Running; }
+  bool HasResults() const { return NextToSend > 0; }
+  size_t SentCount() const { return NextToSend; }
+  const std::vector<BatchCommand> &List() const { return Commands; }
+
+  void Update(int64_t nowMs) {
+    if (!Running)
+      return;
+    while (NextToSend < Commands.size()) {
+      if (NextToSend > 0) {
+        const BatchCommand &prev = Commands[NextToSend - 1];
+        if (nowMs - prev.sentMs < IntervalMs)
+          return;
+        if (WaitForOutput && !Settled(prev, nowMs))
+          return;
+      }
+      BatchCommand &cmd = Commands[NextToSend++];
+      cmd.sentMs = nowMs;
+      if (Send)
+        Send(cmd.text);
+    }
+
+    // everything is out, wait for the tail to settle
+    const BatchCommand &last = Commands.back();
+    if (Settled(last, nowMs)) {
+      Running = false;
+      FinishedMs = last.lastOutputMs >= 0 ? last.lastOutputMs : nowMs;
+    }
+  }
+
+  void OnOutput(size_t idx, int64_t timeMs) {
+    if (!Running || NextToSend == 0)
+      return;
+    // sentMs never decreases, so find the last command sent before the line
+    auto end = Commands.begin() + NextToSend;
+    auto it = std::upper_bound(
+        Commands.begin(), end, timeMs,
+        [](int64_t t, const BatchCommand &c) { return t < c.sentMs; });
+    if (it == Commands.begin())
+      return; // produced before the batch started
+    BatchCommand &cmd = *(it - 1);
+    if (cmd.firstOutputMs < 0)
+      cmd.firstOutputMs = timeMs;
+    cmd.lastOutputMs = std::max(cmd.lastOutputMs, timeMs);
+    cmd.output.push_back(idx);
+  }
+
+  BatchSummary Summarize() const {
+    BatchSummary s;
+    std::vector<int64_t> latencies;
+    int64_t end = StartedMs;
+    for (size_t i = 0; i < NextToSend; i++) {
+      const BatchCommand &cmd = Commands[i];
+      s.sent++;
+      s.outputLines += cmd.output.size();
+      end = std::max({end, cmd.sentMs, cmd.lastOutputMs});
+      if (cmd.firstOutputMs >= 0)
+        latencies.push_back(cmd.firstOutputMs - cmd.sentMs);
+    }
+    if (!Running)
+      end = std::max(end, FinishedMs);
+    s.totalMs = end - StartedMs;
+    s.answered = latencies.size();
+    if (s.totalMs > 0)
+      s.commandsPerSec = s.sent * 1000.0 / (double)s.totalMs;
+    if (!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      int64_t sum = 0;
+      for (int64_t l : latencies)
+        sum += l;
+      s.latencyAvgMs = (double)sum / latencies.size();
+      s.latencyP50Ms = latencies[latencies.size() / 2];
+      size_t p95 = std::min(latencies.size() - 1, latencies.size() * 95 / 100);
+      s.latencyP95Ms = latencies[p95];
+      s.latencyMaxMs = latencies.back();
+    }
+    return s;
+  }
+};
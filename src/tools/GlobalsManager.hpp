@@ -1,4 +1,5 @@
 #pragma once
+#include "LuaLint.hpp"
 #include <algorithm>
 #include <cctype>
 #include <filesystem>
@@ -7,7 +8,9 @@
 #include <map>
 #include <regex>
 #include <set>
+#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -1451,8 +1454,14 @@ class GlobalsManager {
   };
 
   std::map<std::string, DefinitionLocation> GlobalIndex;
+  // file -> globals it defines and on which line
+  std::map<std::string, std::map<std::string, int>> FileDefinitions;
+  // global name -> files using it, and the other way round
+  std::map<std::string, std::set<std::string>> References;
+  std::map<std::string, std::vector<std::string>> FileReferences;
 
   fs::path ScriptsRoot;
+  size_t Revision = 0; // bumped when the set of globals changes
 
   std::string GeneratePrefix(const std::string &filename) {
     std::string stem = fs::path(filename).stem().string();
@@ -1460,19 +1469,102 @@ class GlobalsManager {
     return stem + "_";
   }
 
+  // files are keyed the way ScanAll() finds them
+  static std::string NormalizePath(const std::string &filePath) {
+    std::error_code ec;
+    fs::path rel = fs::relative(filePath, fs::current_path(), ec);
+    std::string path = ec || rel.empty() ? filePath : rel.string();
+    std::replace(path.begin(), path.end(), '\\', '/');
+    return path;
+  }
+
+  // a global file no longer defines; another file may still do
+  void Forget(const std::string &name, const std::string &file) {
+    auto it = GlobalIndex.find(name);
+    if (it == GlobalIndex.end() || it->second.FilePath != file)
+      return;
+    GlobalIndex.erase(it);
+    for (const auto &[other, names] : FileDefinitions) {
+      auto line = names.find(name);
+      if (other != file && line != names.end()) {
+        GlobalIndex[name] = {other, line->second};
+        break;
+      }
+    }
+  }
+
+  // names not following '.' or ':', i.e. everything that may be a global
+  void IndexReferences(const std::string &file, const std::string &source) {
+    for (const auto &name : FileReferences[file])
+      References[name].erase(file);
+    std::set<std::string> names;
+    LuaLint::Lexer lex(source);
+    try {
+      int prev = 0;
+      for (LuaLint::Lexeme t = lex.Next(); t.kind != LuaLint::TkEof;
+           t = lex.Next()) {
+        if (t.kind == LuaLint::TkName && prev != '.' && prev != ':')
+          names.emplace(t.text);
+        prev = t.kind;
+      }
+    } catch (const LuaLint::SyntaxError &) {
+      // keep what was read up to there
+    }
+    for (const auto &name : names)
+      References[name].insert(file);
+    FileReferences[file].assign(names.begin(), names.end());
+  }
+
 public:
+  // luacheck warnings the generated config turns off
+  static const std::vector<int> &IgnoredWarnings() {
+    static const std::vector<int> codes = {211, 212, 213, 231, 311,
+                                           312, 313, 631, 611, 612,
+                                           613, 614, 621, 111};
+    return codes;
+  }
+
   void SetRoot(const fs::path &root) { ScriptsRoot = root; }
 
-  void ScanFile(const std::string &filePath) {
+  // project globals and where they're defined
+  const std::map<std::string, DefinitionLocation> &Globals() const {
+    return GlobalIndex;
+  }
+  size_t GetRevision() const { return Revision; }
+
+  // everything the generated config declares
+  bool IsKnownGlobal(const std::string &name) const {
+    return StaticGlobals.count(name) || GlobalIndex.count(name) ||
+           name == "Disease";
+  }
+  // the same as a copy, for threads that can't ask this one
+  std::unordered_set<std::string> KnownGlobals() const {
+    std::unordered_set<std::string> known(StaticGlobals.begin(),
+                                          StaticGlobals.end());
+    for (const auto &[name, loc] : GlobalIndex)
+      known.insert(name);
+    known.insert("Disease");
+    return known;
+  }
+
+  // Indexes the globals a file defines and the names it references.
+  // Returns the globals it defined before but not now, and the other way
+  // round; files referencing those may now lint differently.
+  std::vector<std::string> ScanFile(const std::string &filePath) {
     if (!fs::exists(filePath))
-      return;
+      return {};
 
     std::ifstream file(filePath);
     if (!file.good()) {
       file.open(fs::current_path() / filePath);
       if (!file.good())
-        return;
+        return {};
     }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string key = NormalizePath(filePath);
+    std::map<std::string, int> defined;
+
     std::string line;
     std::string prefix = GeneratePrefix(filePath);
 
@@ -1491,15 +1583,17 @@ public:
     std::smatch match;
     int lineNum = 0;
     bool insideMainFunction = false;
+    std::istringstream lines(content.str());
 
-    while (std::getline(file, line)) {
+    while (std::getline(lines, line)) {
       lineNum++;
 
       if (std::regex_search(line, match, funcRe)) {
         insideMainFunction = true;
         std::string funcName = match[1].str();
         std::string globalName = prefix + funcName;
-        GlobalIndex[globalName] = {filePath, lineNum};
+        GlobalIndex[globalName] = {key, lineNum};
+        defined[globalName] = lineNum;
         continue;
       }
 
@@ -1527,17 +1621,51 @@ public:
           }
 
           if (isAllCaps && hasAlpha) {
-            GlobalIndex[varName] = {filePath, lineNum};
+            GlobalIndex[varName] = {key, lineNum};
+            defined[varName] = lineNum;
           }
         }
       }
     }
+
+    std::vector<std::string> changed;
+    std::map<std::string, int> &before = FileDefinitions[key];
+    for (const auto &[name, at] : before) {
+      if (!defined.count(name)) {
+        changed.push_back(name);
+        Forget(name, key);
+      }
+    }
+    for (const auto &[name, at] : defined) {
+      if (!before.count(name))
+        changed.push_back(name);
+    }
+    before = std::move(defined);
+    IndexReferences(key, content.str());
+    if (!changed.empty())
+      Revision++;
+    return changed;
+  }
+
+  // files (as indexed) that mention any of names outside a field access
+  std::set<std::string>
+  FilesReferencing(const std::vector<std::string> &names) const {
+    std::set<std::string> files;
+    for (const auto &name : names) {
+      auto it = References.find(name);
+      if (it != References.end())
+        files.insert(it->second.begin(), it->second.end());
+    }
+    return files;
   }
 
   void ScanAll() {
     if (!fs::exists(ScriptsRoot))
       return;
     GlobalIndex.clear();
+    FileDefinitions.clear();
+    References.clear();
+    FileReferences.clear();
 
     try {
       for (const auto &entry : fs::recursive_directory_iterator(ScriptsRoot)) {
@@ -1558,6 +1686,7 @@ public:
       }
     } catch (...) {
     }
+    Revision++;
   }
 
   bool FindDefinition(const std::string &query, DefinitionLocation &outLoc) {
@@ -1599,10 +1728,7 @@ public:
       return;
 
     fs::path configPath = ScriptsRoot / ".luacheckrc";
-    std::ofstream out(configPath);
-
-    if (!out.good())
-      return;
+    std::ostringstream out;
 
     out << "-- AUTOMATICALLY GENERATED BY SECONDAID\n";
     // out << "std = \"lua51\"\n\n";
@@ -1626,11 +1752,24 @@ public:
     }
     out << "}\n\n";
 
-    out << "ignore = "
-           "{\"211\",\"212\",\"213\",\"231\",\"311\",\"312\",\"313\",\"631\","
-           "\"611\",\"612\",\"613\",\"614\",\"621\",\"111\"}\n";
+    out << "ignore = {";
+    for (size_t i = 0; i < IgnoredWarnings().size(); i++)
+      out << (i ? "," : "") << "\"" << IgnoredWarnings()[i] << "\"";
+    out << "}\n";
 
     out << "color = false\n";
     out << "codes = true\n";
+
+    // Called on every save; rewriting an unchanged config would still bump
+    // its mtime and make everything watching it think it changed.
+    std::string config = out.str();
+    std::ifstream current(configPath, std::ios::binary);
+    std::stringstream existing;
+    existing << current.rdbuf();
+    if (current && existing.str() == config)
+      return;
+    current.close();
+    std::ofstream file(configPath, std::ios::binary);
+    file << config;
   }
 };
@@ -0,0 +1,230 @@
+#pragma once
+#include "Luacheck.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Lint results keyed by what decides them: file path, file content and the
+// .luacheckrc in use. Kept in memory and saved to a cache file, so
+// unchanged files are never linted twice, not even across sessions.
+class LintCache {
+  struct Issue {
+    int line, startCol, endCol;
+    char type; // 'W', 'E' or 0 when luacheck printed none
+    std::string message;
+  };
+  struct Entry {
+    std::vector<Issue> issues;
+    uint64_t used = 0; // tick of the last use, oldest go first
+  };
+
+  static constexpr char Magic[8] = {'S', 'A', 'L', 'I', 'N', 'T', 'C', '1'};
+  static constexpr size_t MaxEntries = 50000;
+  // let it grow this far past MaxEntries before trimming, so the sort
+  // happens once per that many stores instead of on every one
+  static constexpr size_t TrimSlack = MaxEntries / 8;
+
+  std::mutex Mutex;
+  std::unordered_map<uint64_t, Entry> Entries;
+  uint64_t Tick = 0;
+  bool Dirty = false;
+  std::string Path;
+
+  std::string ConfigPath;
+  std::filesystem::file_time_type ConfigTime;
+  uint64_t ConfigHash = 0;
+
+  static uint64_t Fnv(std::string_view data,
+                      uint64_t h = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+      h ^= c;
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  // rehashed only when the config file changes on disk
+  uint64_t CurrentConfigHash() {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(ConfigPath, ec);
+    if (ec)
+      return 0;
+    if (mtime != ConfigTime || ConfigHash == 0) {
+      std::ifstream file(ConfigPath, std::ios::binary);
+      std::stringstream ss;
+      ss << file.rdbuf();
+      ConfigHash = Fnv(ss.str());
+      ConfigTime = mtime;
+    }
+    return ConfigHash;
+  }
+
+  // drops the least recently used entries down to MaxEntries
+  void Trim() {
+    std::vector<std::pair<uint64_t, uint64_t>> ages; // used, key
+    ages.reserve(Entries.size());
+    for (const auto &[key, entry] : Entries)
+      ages.emplace_back(entry.used, key);
+    size_t drop = Entries.size() - MaxEntries;
+    std::nth_element(ages.begin(), ages.begin() + drop, ages.end());
+    for (size_t i = 0; i < drop; i++)
+      Entries.erase(ages[i].second);
+  }
+
+  template <typename T> static void Put(std::string &out, T value) {
+    out.append((const char *)&value, sizeof(value));
+  }
+  template <typename T>
+  static bool Take(const char *&p, const char *end, T &value) {
+    if ((size_t)(end - p) < sizeof(value))
+      return false;
+    memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return true;
+  }
+
+public:
+  ~LintCache() { Save(); }
+
+  // loads the cache file; the config decides the hash part of every key
+  void Open(const std::string &cacheFile, const std::string &configPath) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Path = cacheFile;
+    ConfigPath = configPath;
+    ConfigHash = 0;
+    Entries.clear();
+    Dirty = false;
+
+    std::ifstream file(Path, std::ios::binary);
+    if (!file)
+      return;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string data = ss.str();
+    const char *p = data.data(), *end = p + data.size();
+    if (data.size() < sizeof(Magic) || memcmp(p, Magic, sizeof(Magic)) != 0)
+      return;
+    p += sizeof(Magic);
+
+    uint64_t count;
+    if (!Take(p, end, count))
+      return;
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t key;
+      uint32_t issues;
+      if (!Take(p, end, key) || !Take(p, end, issues))
+        break;
+      Entry entry;
+      bool ok = true;
+      for (uint32_t j = 0; j < issues && ok; j++) {
+        Issue issue;
+        uint32_t len;
+        ok = Take(p, end, issue.line) && Take(p, end, issue.startCol) &&
+             Take(p, end, issue.endCol) && Take(p, end, issue.type) &&
+             Take(p, end, len) && (size_t)(end - p) >= len;
+        if (ok) {
+          issue.message.assign(p, len);
+          p += len;
+          entry.issues.push_back(std::move(issue));
+        }
+      }
+      if (!ok)
+        break;
+      Entries[key] = std::move(entry);
+    }
+  }
+
+  // writes the cache file if anything was added since the last save
+  void Save() {
+    std::vector<std::pair<uint64_t, Entry>> snapshot;
+    std::string path;
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      if (!Dirty || Path.empty())
+        return;
+      snapshot.assign(Entries.begin(), Entries.end());
+      path = Path;
+      Dirty = false;
+    }
+    if (snapshot.size() > MaxEntries) {
+      std::nth_element(snapshot.begin(), snapshot.begin() + MaxEntries,
+                       snapshot.end(), [](const auto &a, const auto &b) {
+                         return a.second.used > b.second.used;
+                       });
+      snapshot.resize(MaxEntries);
+    }
+
+    std::string out(Magic, sizeof(Magic));
+    Put<uint64_t>(out, snapshot.size());
+    for (const auto &[key, entry] : snapshot) {
+      Put<uint64_t>(out, key);
+      Put<uint32_t>(out, (uint32_t)entry.issues.size());
+      for (const auto &issue : entry.issues) {
+        Put(out, issue.line);
+        Put(out, issue.startCol);
+        Put(out, issue.endCol);
+        Put(out, issue.type);
+        Put<uint32_t>(out, (uint32_t)issue.message.size());
+        out += issue.message;
+      }
+    }
+    // write aside and swap, a crash mid-save keeps the old cache
+    std::string tmp = path + ".tmp";
+    {
+      std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+      file.write(out.data(), (std::streamsize)out.size());
+      if (!file)
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+  }
+
+  // hash of the config's content, 0 without one
+  uint64_t ConfigVersion() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return CurrentConfigHash();
+  }
+
+  uint64_t Key(const std::string &file, std::string_view content) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    uint64_t h = Fnv(file, CurrentConfigHash());
+    return Fnv(content, Fnv(std::string_view("\0", 1), h));
+  }
+
+  // appends the cached results for key, reported under file
+  bool Get(uint64_t key, const std::string &file,
+           std::vector<LintResult> &out) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    auto it = Entries.find(key);
+    if (it == Entries.end())
+      return false;
+    it->second.used = ++Tick;
+    for (const auto &issue : it->second.issues)
+      out.push_back({file, issue.line, issue.startCol, issue.endCol,
+                     issue.type ? std::string(1, issue.type) : "",
+                     issue.message});
+    return true;
+  }
+
+  void Store(uint64_t key, const std::vector<LintResult> &results) {
+    Entry entry;
+    for (const auto &r : results)
+      entry.issues.push_back({r.line, r.startCol, r.endCol,
+                              r.type.empty() ? '\0' : r.type[0], r.message});
+    std::lock_guard<std::mutex> lock(Mutex);
+    entry.used = ++Tick;
+    Entries[key] = std::move(entry);
+    Dirty = true;
+    if (Entries.size() > MaxEntries + TrimSlack)
+      Trim();
+  }
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <ctime>
+
+// std::localtime hands out one static tm shared by every thread, and the log
+// writer formats times while the UI does. This fills the caller's own.
+inline bool LocalTime(time_t secs, std::tm &out) {
+#ifdef _WIN32
+  return localtime_s(&out, &secs) == 0;
+#else
+  return localtime_r(&secs, &out) != nullptr;
+#endif
+}
@@ -0,0 +1,339 @@
+#pragma once
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Binary log archive (.sal). Layout, all little endian:
+//
+//   header                 "SAIDLOG1"
+//   string heap            message bytes, back to back, no terminators
+//   records                LogArchiveRecord[recordCount]
+//   channels               per channel: uint16 length + name bytes
+//   time index             LogArchiveIndexEntry every IndexStride records
+//   footer                 LogArchiveFooter
+//
+// The heap is written as lines arrive. Records go to a side file and are
+// appended when the archive is closed, so the footer is the last thing
+// written; an archive without a valid footer was not closed cleanly.
+namespace LogArchiveFormat {
+constexpr char Magic[8] = {'S', 'A', 'I', 'D', 'L', 'O', 'G', '1'};
+constexpr uint32_t Version = 1;
+constexpr uint64_t IndexStride = 4096;
+} // namespace LogArchiveFormat
+
+struct LogArchiveRecord {
+  int64_t timeMs;
+  uint64_t offset; // into the heap
+  uint32_t length;
+  uint32_t color; // packed ImU32
+  uint16_t channel;
+  uint16_t reserved;
+  uint32_t reserved2;
+};
+static_assert(sizeof(LogArchiveRecord) == 32, "archive record layout");
+
+// timeMs is the highest time seen up to and including record 'first', so the
+// index stays sorted even when lines arrive slightly out of order
+struct LogArchiveIndexEntry {
+  int64_t timeMs;
+  uint64_t first;
+};
+
+struct LogArchiveFooter {
+  uint64_t recordsOffset;
+  uint64_t recordCount;
+  uint64_t channelsOffset;
+  uint64_t channelCount;
+  uint64_t indexOffset;
+  uint64_t indexCount;
+  uint32_t version;
+  uint32_t reserved;
+  char magic[8];
+};
+
+class LogArchiveWriter {
+  FILE *File = nullptr;
+  FILE *Records = nullptr;
+  std::string Path;
+  std::string RecordsPath;
+
+  uint64_t HeapBytes = 0;
+  uint64_t RecordCount = 0;
+  int64_t MaxTime = INT64_MIN;
+  std::vector<std::string> Channels;
+  std::unordered_map<std::string, uint16_t> ChannelIds;
+  std::vector<LogArchiveIndexEntry> Index;
+
+  static constexpr uint64_t HeaderSize = sizeof(LogArchiveFormat::Magic);
+
+  uint16_t Intern(const std::string &channel) {
+    auto it = ChannelIds.find(channel);
+    if (it != ChannelIds.end())
+      return it->second;
+    if (Channels.size() >= UINT16_MAX)
+      return 0;
+    uint16_t id = (uint16_t)Channels.size();
+    Channels.push_back(channel);
+    ChannelIds.emplace(channel, id);
+    return id;
+  }
+
+public:
+  ~LogArchiveWriter() { Close(); }
+
+  bool IsOpen() const { return File != nullptr; }
+  uint64_t Bytes() const {
+    return HeaderSize + HeapBytes + RecordCount * sizeof(LogArchiveRecord);
+  }
+
+  bool Open(const std::string &path) {
+    Close();
+    Path = path;
+    RecordsPath = path + ".rec";
+    File = fopen(path.c_str(), "wb");
+    Records = fopen(RecordsPath.c_str(), "w+b");
+    if (!File || !Records) {
+      Close();
+      return false;
+    }
+    fwrite(LogArchiveFormat::Magic, 1, HeaderSize, File);
+    HeapBytes = 0;
+    RecordCount = 0;
+    MaxTime = INT64_MIN;
+    Channels.clear();
+    ChannelIds.clear();
+    Index.clear();
+    return true;
+  }
+
+  bool Add(int64_t timeMs, const std::string &channel, uint32_t color,
+           std::string_view msg) {
+    if (!File)
+      return false;
+    LogArchiveRecord rec = {};
+    rec.timeMs = timeMs;
+    rec.offset = HeapBytes;
+    rec.length = (uint32_t)std::min<size_t>(msg.size(), UINT32_MAX);
+    rec.color = color;
+    rec.channel = Intern(channel);
+
+    MaxTime = std::max(MaxTime, timeMs);
+    if (RecordCount % LogArchiveFormat::IndexStride == 0)
+      Index.push_back({MaxTime, RecordCount});
+
+    if (fwrite(msg.data(), 1, rec.length, File) != rec.length ||
+        fwrite(&rec, sizeof(rec), 1, Records) != 1)
+      return false;
+    HeapBytes += rec.length;
+    RecordCount++;
+    return true;
+  }
+
+  void Flush() {
+    if (File)
+      fflush(File);
+    if (Records)
+      fflush(Records);
+  }
+
+  // appends records, channels, index and footer, then drops the side file
+  void Close() {
+    if (File && Records) {
+      LogArchiveFooter footer = {};
+      footer.recordsOffset = HeaderSize + HeapBytes;
+      footer.recordCount = RecordCount;
+
+      fflush(Records);
+      fseek(Records, 0, SEEK_SET);
+      std::vector<char> buf(1 << 20);
+      size_t n;
+      while ((n = fread(buf.data(), 1, buf.size(), Records)) > 0)
+        fwrite(buf.data(), 1, n, File);
+
+      footer.channelsOffset =
+          footer.recordsOffset + RecordCount * sizeof(LogArchiveRecord);
+      footer.channelCount = Channels.size();
+      uint64_t channelBytes = 0;
+      for (const auto &name : Channels) {
+        uint16_t len = (uint16_t)std::min<size_t>(name.size(), UINT16_MAX);
+        fwrite(&len, sizeof(len), 1, File);
+        fwrite(name.data(), 1, len, File);
+        channelBytes += sizeof(len) + len;
+      }
+
+      footer.indexOffset = footer.channelsOffset + channelBytes;
+      footer.indexCount = Index.size();
+      if (!Index.empty())
+        fwrite(Index.data(), sizeof(LogArchiveIndexEntry), Index.size(), File);
+
+      footer.version = LogArchiveFormat::Version;
+      memcpy(footer.magic, LogArchiveFormat::Magic, sizeof(footer.magic));
+      fwrite(&footer, sizeof(footer), 1, File);
+    }
+    if (Records) {
+      fclose(Records);
+      std::error_code ec;
+      std::filesystem::remove(RecordsPath, ec);
+    }
+    if (File)
+      fclose(File);
+    File = nullptr;
+    Records = nullptr;
+  }
+};
+
+// Random access to a closed archive straight from the mapping. Nothing but
+// the channel names is copied, so only the pages actually looked at are
+// ever read.
+class LogArchiveReader {
+  MappedFile Map;
+  // the heap has no alignment, so records and index are read via memcpy
+  const uint8_t *Records = nullptr;
+  const uint8_t *Index = nullptr;
+  const char *Heap = nullptr;
+  uint64_t RecordCount = 0;
+  uint64_t IndexCount = 0;
+  uint64_t HeapSize = 0;
+  std::vector<std::string> Channels;
+  std::string LastError;
+
+  LogArchiveIndexEntry IndexAt(uint64_t i) const {
+    LogArchiveIndexEntry entry;
+    memcpy(&entry, Index + i * sizeof(entry), sizeof(entry));
+    return entry;
+  }
+
+  bool Fail(const std::string &msg) {
+    LastError = msg;
+    Close();
+    return false;
+  }
+
+public:
+  bool Open(const std::string &path) {
+    Close();
+    if (!Map.Open(path))
+      return Fail("Cannot open " + path);
+
+    const uint8_t *base = Map.Bytes();
+    size_t size = Map.Size();
+    constexpr size_t header = sizeof(LogArchiveFormat::Magic);
+    if (size < header + sizeof(LogArchiveFooter) ||
+        memcmp(base, LogArchiveFormat::Magic, header) != 0)
+      return Fail("Not a SecondAID log archive");
+
+    LogArchiveFooter footer;
+    memcpy(&footer, base + size - sizeof(footer), sizeof(footer));
+    if (memcmp(footer.magic, LogArchiveFormat::Magic, sizeof(footer.magic)))
+      return Fail("Archive was not closed cleanly (missing footer)");
+    if (footer.version != LogArchiveFormat::Version)
+      return Fail("Unsupported archive version");
+
+    // every section in order and inside the file; counts are checked by
+    // division, a forged one must not wrap the end offset around
+    uint64_t end = size - sizeof(footer);
+    if (footer.recordsOffset < header || footer.recordsOffset > end ||
+        footer.recordCount >
+            (end - footer.recordsOffset) / sizeof(LogArchiveRecord))
+      return Fail("Corrupt archive");
+    uint64_t recordsEnd =
+        footer.recordsOffset + footer.recordCount * sizeof(LogArchiveRecord);
+    if (footer.channelsOffset < recordsEnd || footer.channelsOffset > end ||
+        footer.indexOffset < footer.channelsOffset ||
+        footer.indexOffset > end ||
+        footer.indexCount >
+            (end - footer.indexOffset) / sizeof(LogArchiveIndexEntry))
+      return Fail("Corrupt archive");
+
+    Heap = (const char *)base + header;
+    HeapSize = footer.recordsOffset - header;
+    RecordCount = footer.recordCount;
+    IndexCount = footer.indexCount;
+    Records = base + footer.recordsOffset;
+    Index = base + footer.indexOffset;
+
+    const uint8_t *p = base + footer.channelsOffset;
+    const uint8_t *channelsEnd = base + footer.indexOffset;
+    for (uint64_t i = 0; i < footer.channelCount; i++) {
+      uint16_t len;
+      if (p + sizeof(len) > channelsEnd)
+        return Fail("Corrupt channel table");
+      memcpy(&len, p, sizeof(len));
+      p += sizeof(len);
+      if (p + len > channelsEnd)
+        return Fail("Corrupt channel table");
+      Channels.emplace_back((const char *)p, len);
+      p += len;
+    }
+    LastError.clear();
+    return true;
+  }
+
+  void Close() {
+    Map.Close();
+    Records = nullptr;
+    Index = nullptr;
+    Heap = nullptr;
+    RecordCount = IndexCount = HeapSize = 0;
+    Channels.clear();
+  }
+
+  bool IsOpen() const { return Map.IsOpen(); }
+  const std::string &Error() const { return LastError; }
+  uint64_t Size() const { return RecordCount; }
+  uint64_t FileSize() const { return Map.Size(); }
+
+  LogArchiveRecord Record(uint64_t idx) const {
+    LogArchiveRecord rec;
+    memcpy(&rec, Records + idx * sizeof(rec), sizeof(rec));
+    return rec;
+  }
+
+  std::string_view Message(const LogArchiveRecord &rec) const {
+    if (rec.offset > HeapSize)
+      return {};
+    uint64_t len = std::min<uint64_t>(rec.length, HeapSize - rec.offset);
+    return std::string_view(Heap + rec.offset, (size_t)len);
+  }
+
+  size_t ChannelCount() const { return Channels.size(); }
+  const std::string &ChannelName(uint16_t id) const {
+    static const std::string unknown = "?";
+    return id < Channels.size() ? Channels[id] : unknown;
+  }
+
+  int64_t FirstTime() const {
+    return RecordCount ? Record(0).timeMs : 0;
+  }
+  int64_t LastTime() const {
+    return RecordCount ? Record(RecordCount - 1).timeMs : 0;
+  }
+
+  // First record at or after timeMs. The sparse index narrows it down to
+  // one stride, which is then scanned.
+  uint64_t FindTime(int64_t timeMs) const {
+    if (RecordCount == 0)
+      return 0;
+    uint64_t lo = 0, hi = IndexCount;
+    while (lo < hi) {
+      uint64_t mid = (lo + hi) / 2;
+      if (IndexAt(mid).timeMs < timeMs)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    uint64_t start = lo == 0 ? 0 : IndexAt(lo - 1).first;
+    for (uint64_t i = start; i < RecordCount; i++) {
+      if (Record(i).timeMs >= timeMs)
+        return i;
+    }
+    return RecordCount - 1;
+  }
+};
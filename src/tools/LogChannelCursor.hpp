@@ -0,0 +1,36 @@
+#pragma once
+#include "LogStore.hpp"
+#include <algorithm>
+#include <string>
+
+// Follows one channel of a LogStore: each Poll() reports the lines added on
+// that channel since the previous one. Only the record's category is looked
+// at, so polling every frame costs next to nothing.
+class LogChannelCursor {
+  size_t Next = 0;
+
+public:
+  // skip everything stored so far
+  void Reset(const LogStore &store) { Next = store.End(); }
+
+  // Calls fn(idx) for every new line on the channel. Returns false when the
+  // store was cleared since the last poll, so callers can drop what they
+  // remember about it.
+  template <typename Fn>
+  bool Poll(const LogStore &store, const std::string &channel, Fn &&fn) {
+    bool intact = store.End() >= Next;
+    if (!intact)
+      Next = store.Begin();
+    Next = std::max(Next, store.Begin());
+
+    int id = store.Categories.Find(channel);
+    if (id >= 0) {
+      for (size_t i = Next; i < store.End(); i++) {
+        if (store[i].category == id)
+          fn(i);
+      }
+    }
+    Next = store.End();
+    return intact;
+  }
+};
@@ -0,0 +1,148 @@
+#pragma once
+#include "LogStore.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class CoalesceMode { Off, Consecutive, RecentWindow };
+
+// How often a stored line was repeated. Only lines that actually repeated
+// have an entry, so this stays tiny compared to the store.
+struct LogRepeat {
+  uint32_t count = 1;
+  int64_t firstMs = 0;
+  int64_t lastMs = 0;
+};
+
+// Collapses duplicate lines per channel before they reach the store, either
+// only when they follow each other or anywhere within the last Window
+// distinct lines of that channel. A line is a duplicate when message and
+// colour are identical.
+class LogCoalescer {
+  struct Seen {
+    size_t idx = SIZE_MAX;
+    int64_t timeMs = 0;
+  };
+
+  struct Channel {
+    Seen last;
+    std::unordered_map<uint64_t, Seen> recent;
+    std::deque<std::pair<uint64_t, size_t>> order;
+  };
+
+  std::vector<Channel> Channels;
+  std::unordered_map<size_t, LogRepeat> Repeats;
+
+  static uint64_t Hash(std::string_view text, uint32_t color) {
+    uint64_t h = 1469598103934665603ull ^ color;
+    for (unsigned char c : text) {
+      h ^= c;
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  static bool Same(const LogStore &store, size_t idx, std::string_view msg,
+                   uint32_t color) {
+    if (!store.Contains(idx))
+      return false;
+    const LogRecord &rec = store[idx];
+    return rec.color == color && store.Message(rec) == msg;
+  }
+
+  Channel &ChannelFor(uint16_t category) {
+    if (category >= Channels.size())
+      Channels.resize(category + 1);
+    return Channels[category];
+  }
+
+  CoalesceMode Mode = CoalesceMode::Off;
+
+public:
+  int Window = 64;
+
+  void Clear() {
+    Channels.clear();
+    Repeats.clear();
+  }
+
+  CoalesceMode GetMode() const { return Mode; }
+
+  // switching modes forgets what was seen, existing counters stay
+  void SetMode(CoalesceMode mode) {
+    Mode = mode;
+    Channels.clear();
+  }
+
+  // Returns the index of an earlier line this one repeats and bumps its
+  // counter, or SIZE_MAX when the line has to be stored.
+  size_t Merge(const LogStore &store, uint16_t category, std::string_view msg,
+               uint32_t color, int64_t timeMs) {
+    if (Mode == CoalesceMode::Off)
+      return SIZE_MAX;
+
+    Channel &ch = ChannelFor(category);
+    const Seen *match = nullptr;
+    if (Mode == CoalesceMode::Consecutive) {
+      if (Same(store, ch.last.idx, msg, color))
+        match = &ch.last;
+    } else {
+      auto it = ch.recent.find(Hash(msg, color));
+      if (it != ch.recent.end() && Same(store, it->second.idx, msg, color))
+        match = &it->second;
+    }
+    if (!match)
+      return SIZE_MAX;
+
+    auto [it, inserted] = Repeats.try_emplace(match->idx);
+    LogRepeat &rep = it->second;
+    if (inserted)
+      rep.firstMs = match->timeMs;
+    rep.count++;
+    rep.lastMs = timeMs;
+    return match->idx;
+  }
+
+  // called for every line that did get stored
+  void Remember(uint16_t category, size_t idx, std::string_view msg,
+                uint32_t color, int64_t timeMs) {
+    if (Mode == CoalesceMode::Off)
+      return;
+    Channel &ch = ChannelFor(category);
+    ch.last = {idx, timeMs};
+    if (Mode != CoalesceMode::RecentWindow)
+      return;
+
+    uint64_t h = Hash(msg, color);
+    ch.recent[h] = {idx, timeMs};
+    ch.order.emplace_back(h, idx);
+    while (ch.order.size() > (size_t)std::max(Window, 1)) {
+      auto [oldHash, oldIdx] = ch.order.front();
+      ch.order.pop_front();
+      auto it = ch.recent.find(oldHash);
+      if (it != ch.recent.end() && it->second.idx == oldIdx)
+        ch.recent.erase(it);
+    }
+  }
+
+  const LogRepeat *Find(size_t idx) const {
+    if (Repeats.empty())
+      return nullptr;
+    auto it = Repeats.find(idx);
+    return it == Repeats.end() ? nullptr : &it->second;
+  }
+
+  void Evict(size_t firstLive) {
+    for (auto it = Repeats.begin(); it != Repeats.end();) {
+      if (it->first < firstLive)
+        it = Repeats.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  size_t RepeatedLines() const { return Repeats.size(); }
+};
@@ -0,0 +1,209 @@
+#pragma once
+#include "LogQuery.hpp"
+#include "LogStore.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs log filter passes on a small pool of threads. A pass is split into
+// fixed-size blocks that workers claim one at a time; the UI thread collects
+// finished blocks in order, so the visible list fills in progressively and
+// always stays sorted. Starting a new pass cancels the previous one.
+class LogFilterWorker {
+  static constexpr size_t BlockSize = 16384;
+
+  struct Block {
+    std::vector<size_t> matches;
+    std::atomic<bool> done{false};
+  };
+
+  struct Pass {
+    LogQuery query;
+    const LogStore *store = nullptr;
+
+    // either a contiguous range of store indices, or an explicit candidate
+    // list when refining the previous result set
+    size_t rangeBegin = 0;
+    size_t rangeEnd = 0;
+    std::vector<size_t> candidates;
+    bool useCandidates = false;
+
+    size_t itemCount = 0;
+    size_t blockCount = 0;
+    std::unique_ptr<Block[]> blocks;
+    std::atomic<size_t> nextBlock{0};
+    std::atomic<bool> cancelled{false};
+  };
+
+  std::vector<std::thread> threads;
+  std::mutex passMutex;
+  std::condition_variable cv;
+  std::shared_ptr<Pass> current;
+  std::atomic<bool> running{true};
+  std::atomic<int> activeBlocks{0};
+
+  // UI side
+  size_t collectedBlocks = 0;
+
+  void ProcessBlock(Pass &pass, size_t blockIdx) {
+    Block &block = pass.blocks[blockIdx];
+    size_t first = blockIdx * BlockSize;
+    size_t last = std::min(first + BlockSize, pass.itemCount);
+
+    // lines evicted while the pass runs are skipped; the guard keeps
+    // everything newer alive until the block is done
+    LogStore::ReadGuard guard(*pass.store);
+    size_t oldest = pass.store->OldestShared();
+
+    for (size_t i = first; i < last; i++) {
+      if ((i & 1023) == 0 && pass.cancelled)
+        return;
+      size_t idx =
+          pass.useCandidates ? pass.candidates[i] : pass.rangeBegin + i;
+      if (idx < oldest)
+        continue;
+      if (pass.query.Matches(*pass.store, (*pass.store)[idx]))
+        block.matches.push_back(idx);
+    }
+    block.done.store(true, std::memory_order_release);
+  }
+
+  void WorkerLoop() {
+    while (running) {
+      std::shared_ptr<Pass> pass;
+      {
+        std::unique_lock<std::mutex> lock(passMutex);
+        cv.wait(lock, [this] {
+          return !running ||
+                 (current && !current->cancelled &&
+                  current->nextBlock.load() < current->blockCount);
+        });
+        if (!running)
+          break;
+        pass = current;
+        activeBlocks++;
+      }
+
+      while (!pass->cancelled) {
+        size_t blockIdx = pass->nextBlock.fetch_add(1);
+        if (blockIdx >= pass->blockCount)
+          break;
+        ProcessBlock(*pass, blockIdx);
+      }
+      activeBlocks--;
+    }
+  }
+
+  void StartPass(std::shared_ptr<Pass> pass) {
+    pass->blockCount = (pass->itemCount + BlockSize - 1) / BlockSize;
+    pass->blocks = std::make_unique<Block[]>(pass->blockCount);
+    {
+      std::lock_guard<std::mutex> lock(passMutex);
+      if (current)
+        current->cancelled = true;
+      current = pass;
+    }
+    collectedBlocks = 0;
+    cv.notify_all();
+  }
+
+public:
+  LogFilterWorker() {
+    unsigned cores = std::thread::hardware_concurrency();
+    unsigned count = std::clamp(cores > 1 ? cores - 1 : 1u, 1u, 8u);
+    for (unsigned i = 0; i < count; i++)
+      threads.emplace_back(&LogFilterWorker::WorkerLoop, this);
+  }
+
+  ~LogFilterWorker() {
+    running = false;
+    Cancel();
+    cv.notify_all();
+    for (auto &t : threads) {
+      if (t.joinable())
+        t.join();
+    }
+  }
+
+  void FilterRange(const LogStore &store, const LogQuery &query,
+                   size_t begin, size_t end) {
+    auto pass = std::make_shared<Pass>();
+    pass->query = query;
+    pass->store = &store;
+    pass->rangeBegin = begin;
+    pass->rangeEnd = end;
+    pass->itemCount = end - begin;
+    StartPass(pass);
+  }
+
+  void FilterCandidates(const LogStore &store, const LogQuery &query,
+                        std::vector<size_t> candidates) {
+    auto pass = std::make_shared<Pass>();
+    pass->query = query;
+    pass->store = &store;
+    pass->candidates = std::move(candidates);
+    pass->useCandidates = true;
+    pass->itemCount = pass->candidates.size();
+    StartPass(pass);
+  }
+
+  // Stops the current pass. With wait set, also blocks until no worker is
+  // touching the store anymore (needed before clearing it).
+  void Cancel(bool wait = false) {
+    {
+      std::lock_guard<std::mutex> lock(passMutex);
+      if (current)
+        current->cancelled = true;
+      current.reset();
+    }
+    collectedBlocks = 0;
+    while (wait && activeBlocks > 0)
+      std::this_thread::yield();
+  }
+
+  bool IsBusy() {
+    std::lock_guard<std::mutex> lock(passMutex);
+    return current != nullptr;
+  }
+
+  float Progress() {
+    std::lock_guard<std::mutex> lock(passMutex);
+    if (!current || current->blockCount == 0)
+      return 1.0f;
+    return (float)collectedBlocks / (float)current->blockCount;
+  }
+
+  // Appends the results of all blocks finished so far, in order. Returns true
+  // once the whole pass has been collected.
+  bool Collect(std::vector<size_t> &out) {
+    std::shared_ptr<Pass> pass;
+    {
+      std::lock_guard<std::mutex> lock(passMutex);
+      pass = current;
+    }
+    if (!pass)
+      return false;
+
+    while (collectedBlocks < pass->blockCount &&
+           pass->blocks[collectedBlocks].done.load(
+               std::memory_order_acquire)) {
+      auto &matches = pass->blocks[collectedBlocks].matches;
+      out.insert(out.end(), matches.begin(), matches.end());
+      matches.clear();
+      matches.shrink_to_fit();
+      collectedBlocks++;
+    }
+
+    if (collectedBlocks < pass->blockCount)
+      return false;
+
+    std::lock_guard<std::mutex> lock(passMutex);
+    if (current == pass)
+      current.reset();
+    return true;
+  }
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include "LogStore.hpp"
+#include "TextMatch.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Thread-safe equivalent of ImGuiTextFilter for log lines: comma separated
+// terms, case insensitive, '-' prefix excludes. A line passes when either
+// its message or its category passes, same as the UI filter always did.
+class LogQuery {
+  TextMatch::Filter Terms;
+
+  // which interned categories pass the text filter by name, computed once per
+  // query so workers never touch the category table
+  std::vector<uint8_t> CategoryPasses;
+
+public:
+  int Category = LogCategoryTable::All;
+
+  LogQuery() = default;
+
+  LogQuery(const char *filterText, int category)
+      : Terms(filterText), Category(category) {}
+
+  bool HasTextFilter() const { return Terms.IsActive(); }
+
+  // include terms, already folded to lowercase
+  const std::vector<std::string> &IncludeTerms() const {
+    return Terms.IncludeTerms();
+  }
+
+  size_t BoundCategories() const { return CategoryPasses.size(); }
+
+  // true when some allowed category passes by name alone, so lines can match
+  // without the message containing any include term
+  bool AnyCategoryPasses() const {
+    for (size_t i = 0; i < CategoryPasses.size(); i++) {
+      if (CategoryPasses[i] &&
+          (Category == LogCategoryTable::All || Category == (int)i))
+        return true;
+    }
+    return false;
+  }
+
+  void BindCategories(const LogCategoryTable &categories) {
+    CategoryPasses.assign(categories.Size(), 0);
+    for (size_t i = 0; i < categories.Size(); i++)
+      CategoryPasses[i] = Terms.Pass(categories.Name((int)i)) ? 1 : 0;
+  }
+
+  bool Matches(const LogStore &store, const LogRecord &rec) const {
+    if (Category != LogCategoryTable::All && rec.category != Category)
+      return false;
+    if (!HasTextFilter())
+      return true;
+    if (rec.category < CategoryPasses.size() && CategoryPasses[rec.category])
+      return true;
+    return Terms.Pass(store.Message(rec));
+  }
+
+  // true when every line matching this query is guaranteed to also match
+  // 'prev', so a refined search only needs to re-check prev's results
+  bool IsRefinementOf(const LogQuery &prev) const {
+    if (prev.Category != LogCategoryTable::All && prev.Category != Category)
+      return false;
+
+    for (const auto &oldEx : prev.Terms.ExcludeTerms()) {
+      bool covered = false;
+      for (const auto &ex : Terms.ExcludeTerms()) {
+        if (TextMatch::Contains(oldEx, ex)) {
+          covered = true;
+          break;
+        }
+      }
+      if (!covered)
+        return false;
+    }
+
+    if (prev.IncludeTerms().empty())
+      return true;
+    if (IncludeTerms().empty())
+      return false;
+
+    for (const auto &in : IncludeTerms()) {
+      bool covered = false;
+      for (const auto &oldIn : prev.IncludeTerms()) {
+        if (TextMatch::Contains(in, oldIn)) {
+          covered = true;
+          break;
+        }
+      }
+      if (!covered)
+        return false;
+    }
+    return true;
+  }
+};
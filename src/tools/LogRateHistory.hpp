@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lines per second for each channel over the last HistorySeconds seconds,
+// kept as a ring of per-second buckets. Buckets are stamped with the second
+// they belong to, so stale ones read as zero without ever being swept.
+class LogRateHistory {
+public:
+  static constexpr int HistorySeconds = 120;
+
+private:
+  struct Channel {
+    int64_t stamp[HistorySeconds];
+    uint32_t count[HistorySeconds];
+    Channel() {
+      for (int i = 0; i < HistorySeconds; i++) {
+        stamp[i] = -1;
+        count[i] = 0;
+      }
+    }
+  };
+
+  std::vector<Channel> Channels;
+
+  static int Slot(int64_t second) {
+    int64_t slot = second % HistorySeconds;
+    return (int)(slot < 0 ? slot + HistorySeconds : slot);
+  }
+
+public:
+  void Clear() { Channels.clear(); }
+
+  void Count(uint16_t category, int64_t timeMs) {
+    if (category >= Channels.size())
+      Channels.resize(category + 1);
+    Channel &ch = Channels[category];
+    int64_t second = timeMs / 1000;
+    int slot = Slot(second);
+    if (ch.stamp[slot] != second) {
+      // an older second than the bucket holds has already scrolled out
+      if (ch.stamp[slot] > second)
+        return;
+      ch.stamp[slot] = second;
+      ch.count[slot] = 0;
+    }
+    ch.count[slot]++;
+  }
+
+  size_t ChannelCount() const { return Channels.size(); }
+
+  // Fills out[HistorySeconds] with the rate of each second, oldest first,
+  // ending at nowMs. Returns the peak rate in that window.
+  float Series(uint16_t category, int64_t nowMs, float *out) const {
+    float peak = 0.0f;
+    int64_t last = nowMs / 1000;
+    for (int i = 0; i < HistorySeconds; i++) {
+      int64_t second = last - (HistorySeconds - 1) + i;
+      float value = 0.0f;
+      if (category < Channels.size()) {
+        const Channel &ch = Channels[category];
+        int slot = Slot(second);
+        if (ch.stamp[slot] == second)
+          value = (float)ch.count[slot];
+      }
+      out[i] = value;
+      if (value > peak)
+        peak = value;
+    }
+    return peak;
+  }
+};
@@ -0,0 +1,363 @@
+#pragma once
+#include "ChildProcess.hpp"
+#include "LocalTime.hpp"
+#include "LogArchive.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogSinkFormat { Text, Archive, Both };
+
+struct LogSinkConfig {
+  std::string Directory = "logs";
+  LogSinkFormat Format = LogSinkFormat::Text;
+  size_t MaxFileBytes = 64ull << 20;
+  int MaxFileMinutes = 60; // 0 = rotate by size only
+  bool Compress = false; // text files only, archives stay mappable
+  // lines waiting for the writer; beyond this new lines are dropped
+  size_t MaxPendingLines = 500000;
+};
+
+// Writes log lines to rotating session files on disk. Write() only moves
+// the line into a pending batch under a short lock; a writer thread
+// formats and flushes whole batches, so a slow disk never stalls the
+// receiver or the UI. When the writer falls behind by more than
+// MaxPendingLines, new lines are counted as dropped instead of queued.
+class LogSink {
+  struct Entry {
+    int64_t timeMs;
+    uint32_t color;
+    const char *source;
+    std::string channel;
+    std::string msg;
+  };
+
+  std::mutex QueueMutex;
+  std::condition_variable QueueCv;
+  std::vector<Entry> Pending;
+  LogSinkConfig Config;
+  bool Running = false;
+  std::thread Writer;
+
+  // closed segments waiting for compression, on their own thread so a big
+  // file does not hold up writing
+  std::mutex CompressMutex;
+  std::condition_variable CompressCv;
+  std::deque<std::string> CompressQueue;
+  bool CompressRunning = false;
+  std::thread Compressor;
+
+  std::atomic<bool> Enabled{false};
+  std::atomic<uint64_t> Written{0};
+  std::atomic<uint64_t> Dropped{0};
+  std::atomic<uint64_t> BytesWritten{0};
+  std::atomic<size_t> PendingCount{0};
+
+  mutable std::mutex FileMutex;
+  std::string FilePath;
+  std::string LastError;
+
+  static constexpr auto FlushInterval = std::chrono::milliseconds(250);
+
+  static std::string FileStem(int64_t ms, int part) {
+    time_t secs = (time_t)(ms / 1000);
+    std::tm t;
+    char buf[64];
+    if (LocalTime(secs, t))
+      strftime(buf, sizeof(buf), "session_%Y%m%d_%H%M%S", &t);
+    else
+      snprintf(buf, sizeof(buf), "session_%lld", (long long)secs);
+    return std::string(buf) + "_" + std::to_string(part);
+  }
+
+  static int64_t NowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // the formatted time only changes once per second, so cache it
+  struct TimeFormatter {
+    int64_t second = INT64_MIN;
+    char text[16] = "";
+
+    void Append(std::string &out, int64_t ms) {
+      int64_t s = ms / 1000;
+      if (s != second) {
+        second = s;
+        time_t secs = (time_t)s;
+        std::tm t;
+        if (LocalTime(secs, t))
+          strftime(text, sizeof(text), "%H:%M:%S", &t);
+        else
+          snprintf(text, sizeof(text), "??:??:??");
+      }
+      char millis[8];
+      snprintf(millis, sizeof(millis), ".%03d ", (int)(ms % 1000));
+      out += text;
+      out += millis;
+    }
+  };
+
+  void SetError(const std::string &msg) {
+    std::lock_guard<std::mutex> lock(FileMutex);
+    LastError = msg;
+  }
+
+  void WriterLoop() {
+    FILE *file = nullptr;
+    LogArchiveWriter archive;
+    int64_t openedMs = 0;
+    size_t fileBytes = 0;
+    int part = 0;
+    int64_t sessionMs = NowMs();
+    std::string openPath;
+    std::vector<Entry> batch;
+    std::string out;
+    TimeFormatter clock;
+
+    auto closeSegment = [&](bool compress) {
+      archive.Close();
+      if (!file)
+        return;
+      fclose(file);
+      file = nullptr;
+      if (compress) {
+        std::lock_guard<std::mutex> lock(CompressMutex);
+        CompressQueue.push_back(openPath);
+        CompressCv.notify_one();
+      }
+    };
+
+    auto openSegment = [&](const LogSinkConfig &config, int64_t now) {
+      std::error_code ec;
+      std::filesystem::create_directories(config.Directory, ec);
+      std::string stem = (std::filesystem::path(config.Directory) /
+                          FileStem(sessionMs, part++))
+                             .string();
+      bool ok = true;
+      std::string shown;
+      if (config.Format != LogSinkFormat::Archive) {
+        openPath = stem + ".log";
+        file = fopen(openPath.c_str(), "wb");
+        ok &= file != nullptr;
+        shown = openPath;
+      }
+      if (config.Format != LogSinkFormat::Text) {
+        ok &= archive.Open(stem + ".sal");
+        shown = shown.empty() ? stem + ".sal" : shown + " + .sal";
+      }
+      if (!ok) {
+        closeSegment(false);
+        SetError("Cannot open " + stem);
+        return;
+      }
+      openedMs = now;
+      fileBytes = 0;
+      std::lock_guard<std::mutex> lock(FileMutex);
+      FilePath = shown;
+      LastError.clear();
+    };
+
+    while (true) {
+      LogSinkConfig config;
+      bool stopping;
+      {
+        std::unique_lock<std::mutex> lock(QueueMutex);
+        QueueCv.wait_for(lock, FlushInterval,
+                         [this] { return !Running || !Pending.empty(); });
+        batch.swap(Pending);
+        PendingCount = 0;
+        config = Config;
+        stopping = !Running;
+      }
+
+      if (!batch.empty()) {
+        int64_t now = NowMs();
+        bool open = file || archive.IsOpen();
+        bool expired = config.MaxFileMinutes > 0 &&
+                       now - openedMs >= config.MaxFileMinutes * 60000ll;
+        size_t segmentBytes = std::max<size_t>(fileBytes, archive.Bytes());
+        if (open && (segmentBytes >= config.MaxFileBytes || expired))
+          closeSegment(config.Compress);
+        if (!file && !archive.IsOpen())
+          openSegment(config, now);
+
+        bool failed = !file && !archive.IsOpen();
+        if (file) {
+          out.clear();
+          for (const auto &e : batch) {
+            clock.Append(out, e.timeMs);
+            out += e.source;
+            out += " [";
+            out += e.channel;
+            out += "] ";
+            out += e.msg;
+            out += '\n';
+          }
+          size_t n = fwrite(out.data(), 1, out.size(), file);
+          fflush(file);
+          fileBytes += n;
+          BytesWritten += n;
+          if (n != out.size()) {
+            SetError("Write failed on " + openPath);
+            failed = true;
+          }
+        }
+        if (archive.IsOpen()) {
+          uint64_t before = archive.Bytes();
+          for (const auto &e : batch) {
+            if (!archive.Add(e.timeMs, e.channel, e.color, e.msg)) {
+              SetError("Write failed on archive");
+              failed = true;
+              break;
+            }
+          }
+          archive.Flush();
+          BytesWritten += archive.Bytes() - before;
+        }
+        if (failed)
+          Dropped += batch.size();
+        else
+          Written += batch.size();
+        batch.clear();
+      }
+
+      if (stopping) {
+        closeSegment(config.Compress);
+        return;
+      }
+    }
+  }
+
+  // argv straight to the process, no shell to misread the path
+  static void CompressFile(const std::string &path) {
+    namespace fs = std::filesystem;
+    fs::path p(path);
+    std::string output;
+    int exitCode = 0;
+#ifdef _WIN32
+    // Windows 10+ ships bsdtar but no gzip
+    if (ChildProcess::Run({"tar", "-czf", path + ".tar.gz", "-C",
+                           p.parent_path().string(), p.filename().string()},
+                          "", output, &exitCode) &&
+        exitCode == 0) {
+      std::error_code ec;
+      fs::remove(p, ec);
+    }
+#else
+    ChildProcess::Run({"gzip", "-f", path}, "", output, &exitCode);
+#endif
+  }
+
+  void CompressorLoop() {
+    while (true) {
+      std::string path;
+      {
+        std::unique_lock<std::mutex> lock(CompressMutex);
+        CompressCv.wait(lock, [this] {
+          return !CompressRunning || !CompressQueue.empty();
+        });
+        if (CompressQueue.empty())
+          return;
+        path = std::move(CompressQueue.front());
+        CompressQueue.pop_front();
+      }
+      CompressFile(path);
+    }
+  }
+
+public:
+  ~LogSink() { Stop(); }
+
+  bool IsEnabled() const { return Enabled; }
+
+  // Opens a new session; files are created lazily on the first line.
+  void Start(const LogSinkConfig &config) {
+    Stop();
+    {
+      std::lock_guard<std::mutex> lock(QueueMutex);
+      Config = config;
+      Running = true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(CompressMutex);
+      CompressRunning = true;
+    }
+    Written = 0;
+    Dropped = 0;
+    BytesWritten = 0;
+    Writer = std::thread(&LogSink::WriterLoop, this);
+    Compressor = std::thread(&LogSink::CompressorLoop, this);
+    Enabled = true;
+  }
+
+  // flushes what is queued and closes the current file
+  void Stop() {
+    Enabled = false;
+    {
+      std::lock_guard<std::mutex> lock(QueueMutex);
+      Running = false;
+    }
+    QueueCv.notify_all();
+    if (Writer.joinable())
+      Writer.join();
+    {
+      std::lock_guard<std::mutex> lock(CompressMutex);
+      CompressRunning = false;
+    }
+    CompressCv.notify_all();
+    if (Compressor.joinable())
+      Compressor.join();
+  }
+
+  // rotation and compression settings apply from the next batch
+  void SetConfig(const LogSinkConfig &config) {
+    std::lock_guard<std::mutex> lock(QueueMutex);
+    Config = config;
+  }
+
+  // Safe to call from any thread. source is expected to be a literal, color
+  // is a packed ImU32 kept only in archives.
+  void Write(const char *source, const std::string &channel,
+             const std::string &msg, uint32_t color, int64_t timeMs = 0) {
+    if (!Enabled.load(std::memory_order_relaxed))
+      return;
+    if (timeMs == 0)
+      timeMs = NowMs();
+    std::lock_guard<std::mutex> lock(QueueMutex);
+    if (!Running)
+      return;
+    if (Pending.size() >= Config.MaxPendingLines) {
+      Dropped++;
+      return;
+    }
+    Pending.push_back({timeMs, color, source, channel, msg});
+    PendingCount = Pending.size();
+  }
+
+  uint64_t WrittenLines() const { return Written; }
+  uint64_t DroppedLines() const { return Dropped; }
+  uint64_t WrittenBytes() const { return BytesWritten; }
+  size_t PendingLines() const { return PendingCount; }
+
+  std::string CurrentFile() const {
+    std::lock_guard<std::mutex> lock(FileMutex);
+    return FilePath;
+  }
+
+  std::string Error() const {
+    std::lock_guard<std::mutex> lock(FileMutex);
+    return LastError;
+  }
+};
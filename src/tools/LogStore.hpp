@@ -0,0 +1,608 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Fixed-size record for a single log line. The message itself lives in the
+// store's arena, the category is an interned id. The colour is already packed
+// the way the renderer wants it, so drawing a row needs no conversion. The
+// receive time is kept as milliseconds after the base time of its group of
+// records, see LogStore::Time().
+struct LogRecord {
+  uint32_t chunk;
+  uint32_t offset;
+  uint32_t length;
+  uint16_t category;
+  uint16_t timeDelta;
+  uint32_t color;
+};
+
+// There are only a handful of channels, so every category string is stored
+// once and entries refer to it by a small id. Id 0 is the empty category.
+class LogCategoryTable {
+  std::vector<std::string> Names;
+  std::vector<std::string> Prefixes;
+  std::vector<uint16_t> SortedIds;
+  std::unordered_map<std::string, uint16_t> Ids;
+
+  // consecutive lines almost always come from the same channel
+  uint16_t LastId = 0;
+
+public:
+  static constexpr int All = -1;
+
+  LogCategoryTable() { Clear(); }
+
+  void Clear() {
+    Names.clear();
+    Prefixes.clear();
+    SortedIds.clear();
+    Ids.clear();
+    Names.push_back("");
+    Prefixes.push_back("");
+    Ids[""] = 0;
+    LastId = 0;
+  }
+
+  uint16_t Intern(const std::string &name) {
+    if (Names[LastId] == name)
+      return LastId;
+
+    auto it = Ids.find(name);
+    if (it != Ids.end()) {
+      LastId = it->second;
+      return LastId;
+    }
+
+    uint16_t id = (uint16_t)Names.size();
+    Names.push_back(name);
+    Prefixes.push_back("[" + name + "] ");
+    Ids[name] = id;
+
+    auto pos = std::lower_bound(
+        SortedIds.begin(), SortedIds.end(), name,
+        [this](uint16_t a, const std::string &b) { return Names[a] < b; });
+    SortedIds.insert(pos, id);
+
+    LastId = id;
+    return id;
+  }
+
+  // id of an existing category, -1 if no line used it yet
+  int Find(const std::string &name) const {
+    auto it = Ids.find(name);
+    return it == Ids.end() ? -1 : it->second;
+  }
+
+  const std::string &Name(int id) const { return Names[id]; }
+
+  // "[name] " as shown in front of each line, empty for the empty category
+  const std::string &Prefix(int id) const { return Prefixes[id]; }
+  size_t Size() const { return Names.size(); }
+
+  // non-empty categories in alphabetical order, for the combo box
+  const std::vector<uint16_t> &Sorted() const { return SortedIds; }
+};
+
+// Scratch file holding message chunks that were paged out of memory. Space
+// is handed out in ChunkSize slots and reused once a chunk is evicted.
+// Callers serialize access.
+class LogSpillFile {
+  std::fstream File;
+  std::string Path;
+  std::vector<uint64_t> FreeSlots;
+  uint64_t SlotCount = 0;
+
+  bool EnsureOpen() {
+    if (File.is_open())
+      return true;
+    static std::atomic<int> counter{0};
+    auto name = "secondaid_spill_" +
+                std::to_string(std::chrono::steady_clock::now()
+                                   .time_since_epoch()
+                                   .count()) +
+                "_" + std::to_string(counter++) + ".bin";
+    std::error_code ec;
+    auto dir = std::filesystem::temp_directory_path(ec);
+    Path = (ec ? std::filesystem::path(name) : dir / name).string();
+    File.open(Path, std::ios::in | std::ios::out | std::ios::binary |
+                        std::ios::trunc);
+    return File.is_open();
+  }
+
+public:
+  static constexpr uint64_t SlotSize = 1u << 20;
+
+  ~LogSpillFile() { Close(); }
+
+  void Close() {
+    if (File.is_open()) {
+      File.close();
+      std::error_code ec;
+      std::filesystem::remove(Path, ec);
+    }
+    FreeSlots.clear();
+    SlotCount = 0;
+  }
+
+  // returns the slot written, or -1 when the disk refused
+  int64_t Write(const char *data, size_t size) {
+    if (size > SlotSize || !EnsureOpen())
+      return -1;
+    uint64_t slot;
+    if (!FreeSlots.empty()) {
+      slot = FreeSlots.back();
+      FreeSlots.pop_back();
+    } else {
+      slot = SlotCount++;
+    }
+    File.seekp((std::streamoff)(slot * SlotSize));
+    File.write(data, (std::streamsize)size);
+    if (!File) {
+      File.clear();
+      FreeSlots.push_back(slot);
+      return -1;
+    }
+    return (int64_t)slot;
+  }
+
+  bool Read(int64_t slot, char *out, size_t size) {
+    File.seekg((std::streamoff)(slot * SlotSize));
+    File.read(out, (std::streamsize)size);
+    if (!File) {
+      File.clear();
+      return false;
+    }
+    return true;
+  }
+
+  void Free(int64_t slot) { FreeSlots.push_back((uint64_t)slot); }
+
+  uint64_t UsedBytes() const {
+    return (SlotCount - FreeSlots.size()) * SlotSize;
+  }
+};
+
+// Append-only storage for message bytes. Messages are packed into large
+// chunks, each one followed by a '\0' so it can be handed to C APIs directly.
+// Chunk ids only ever grow and live in a fixed ring of slots, so filter
+// workers can read published messages while the UI thread keeps appending
+// and old chunks get retired.
+//
+// With a memory budget set, the least recently read full chunks are paged
+// out to a LogSpillFile and read back the next time anything touches them.
+// Readers see a chunk through an atomic pointer; a paged out buffer is only
+// freed in ReleaseDropped(), i.e. once no background reader can hold it.
+class LogArena {
+  struct Chunk {
+    std::unique_ptr<char[]> data; // resident copy, null while paged out
+    std::atomic<const char *> view{nullptr};
+    uint32_t capacity = 0;
+    size_t lastRecord = 0;
+    int64_t fileSlot = -1; // already on disk, paging out is free
+    std::atomic<uint64_t> lastUse{0};
+
+    void Reset() {
+      data.reset();
+      view.store(nullptr, std::memory_order_relaxed);
+      capacity = 0;
+      lastRecord = 0;
+      fileSlot = -1;
+      lastUse.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  std::unique_ptr<Chunk[]> Chunks;
+  uint32_t FirstChunk = 0;
+  uint32_t NextChunk = 0;
+  uint32_t Used = 0;
+  size_t ReservedBytes = 0;
+
+  // paging state, shared with readers that page chunks back in
+  mutable std::mutex PageMutex;
+  mutable LogSpillFile Spill;
+  mutable std::vector<std::unique_ptr<char[]>> Dropped;
+  mutable std::atomic<size_t> ResidentBytes{0};
+  std::atomic<bool> HasDroppedBuffers{false};
+  std::atomic<uint64_t> UseClock{1};
+  std::atomic<size_t> BudgetBytes{0};
+  // after a failed spill write (e.g. disk full) the next try waits this
+  // many ticks instead of retrying a 1 MB write every frame
+  static constexpr uint64_t RetryTicks = 120;
+  uint64_t NextAttempt = 0;
+
+  Chunk &Slot(uint32_t id) const { return Chunks[id % MaxChunks]; }
+
+  const char *PageIn(Chunk &c) const {
+    std::lock_guard<std::mutex> lock(PageMutex);
+    const char *view = c.view.load(std::memory_order_acquire);
+    if (view || c.fileSlot < 0)
+      return view;
+    auto data = std::make_unique<char[]>(c.capacity);
+    if (!Spill.Read(c.fileSlot, data.get(), c.capacity)) {
+      // keep the row drawable even if the scratch file went bad
+      memset(data.get(), 0, c.capacity);
+    }
+    c.data = std::move(data);
+    ResidentBytes += c.capacity;
+    c.view.store(c.data.get(), std::memory_order_release);
+    return c.data.get();
+  }
+
+  // PageMutex held
+  bool PageOut(Chunk &c) {
+    if (c.fileSlot < 0) {
+      c.fileSlot = Spill.Write(c.data.get(), c.capacity);
+      if (c.fileSlot < 0)
+        return false;
+    }
+    c.view.store(nullptr, std::memory_order_release);
+    ResidentBytes -= c.capacity;
+    Dropped.push_back(std::move(c.data));
+    HasDroppedBuffers = true;
+    return true;
+  }
+
+public:
+  static constexpr uint32_t ChunkSize = 1u << 20;
+  static constexpr uint32_t MaxChunks = 1u << 16;
+
+  LogArena() : Chunks(std::make_unique<Chunk[]>(MaxChunks)) {}
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(PageMutex);
+    for (uint32_t id = FirstChunk; id != NextChunk; id++)
+      Slot(id).Reset();
+    FirstChunk = NextChunk = 0;
+    Used = 0;
+    ReservedBytes = 0;
+    ResidentBytes = 0;
+    Dropped.clear();
+    HasDroppedBuffers = false;
+    Spill.Close();
+    NextAttempt = 0;
+  }
+
+  // true when the text went into a newly allocated chunk
+  bool Append(const char *text, size_t len, size_t recordIdx,
+              uint32_t &outChunk, uint32_t &outOffset) {
+    uint32_t needed = (uint32_t)len + 1;
+    bool fresh = false;
+
+    if (NextChunk == FirstChunk ||
+        Used + needed > Slot(NextChunk - 1).capacity) {
+      // an oversized message gets a chunk of its own, so the next append
+      // starts a fresh one again
+      uint32_t capacity = std::max(needed, ChunkSize);
+      Chunk &chunk = Slot(NextChunk++);
+      chunk.data = std::make_unique<char[]>(capacity);
+      chunk.capacity = capacity;
+      chunk.lastUse.store(UseClock.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+      chunk.view.store(chunk.data.get(), std::memory_order_release);
+      ReservedBytes += capacity;
+      ResidentBytes += capacity;
+      Used = 0;
+      fresh = true;
+    }
+
+    Chunk &c = Slot(NextChunk - 1);
+    memcpy(c.data.get() + Used, text, len);
+    c.data[Used + len] = '\0';
+    c.lastRecord = recordIdx;
+
+    outChunk = NextChunk - 1;
+    outOffset = Used;
+    Used += needed;
+    return fresh;
+  }
+
+  // Marks every chunk that only holds records older than firstRecord as
+  // retired. The memory stays valid until Release() is called for it.
+  void Retire(size_t firstRecord, std::vector<uint32_t> &outRetired) {
+    while (FirstChunk + 1 < NextChunk &&
+           Slot(FirstChunk).lastRecord < firstRecord) {
+      ReservedBytes -= Slot(FirstChunk).capacity;
+      outRetired.push_back(FirstChunk++);
+    }
+  }
+
+  void Release(uint32_t id) {
+    std::lock_guard<std::mutex> lock(PageMutex);
+    Chunk &c = Slot(id);
+    if (c.data)
+      ResidentBytes -= c.capacity;
+    if (c.fileSlot >= 0)
+      Spill.Free(c.fileSlot);
+    c.Reset();
+  }
+
+  // frees buffers of paged out chunks, only when no reader is active
+  void ReleaseDropped() {
+    std::lock_guard<std::mutex> lock(PageMutex);
+    Dropped.clear();
+    HasDroppedBuffers = false;
+  }
+
+  bool HasDropped() const { return HasDroppedBuffers; }
+
+  const char *Get(uint32_t chunk, uint32_t offset) const {
+    Chunk &c = Slot(chunk);
+    if (BudgetBytes.load(std::memory_order_relaxed) != 0) {
+      uint64_t now = UseClock.load(std::memory_order_relaxed);
+      if (c.lastUse.load(std::memory_order_relaxed) != now)
+        c.lastUse.store(now, std::memory_order_relaxed);
+    }
+    const char *view = c.view.load(std::memory_order_acquire);
+    if (!view)
+      view = PageIn(c);
+    return view + offset;
+  }
+
+  // 0 keeps everything in memory
+  void SetBudget(size_t bytes) {
+    BudgetBytes = bytes;
+    NextAttempt = 0;
+  }
+  size_t Budget() const { return BudgetBytes; }
+
+  // starts a new period for the least recently used order
+  void Tick() { UseClock++; }
+
+  // Pages out the least recently used full chunks until resident memory is
+  // back under 90% of the budget. UI thread only.
+  void EnforceBudget() {
+    size_t budget = BudgetBytes;
+    if (budget == 0 || ResidentBytes <= budget || UseClock < NextAttempt)
+      return;
+
+    std::lock_guard<std::mutex> lock(PageMutex);
+    std::vector<std::pair<uint64_t, uint32_t>> cold;
+    for (uint32_t id = FirstChunk; id + 1 < NextChunk; id++) {
+      const Chunk &c = Slot(id);
+      // oversized chunks don't fit a spill slot and stay resident
+      if (c.data && c.capacity <= LogSpillFile::SlotSize)
+        cold.emplace_back(c.lastUse.load(std::memory_order_relaxed), id);
+    }
+    std::sort(cold.begin(), cold.end());
+
+    size_t target = budget / 10 * 9;
+    for (const auto &entry : cold) {
+      if (ResidentBytes <= target)
+        break;
+      if (!PageOut(Slot(entry.second))) {
+        NextAttempt = UseClock + RetryTicks;
+        break;
+      }
+    }
+  }
+
+  // RAM actually held by message bytes, and how much sits in the spill file
+  size_t MemoryUsage() const { return ResidentBytes; }
+  size_t SpilledBytes() const {
+    std::lock_guard<std::mutex> lock(PageMutex);
+    return Spill.UsedBytes();
+  }
+};
+
+// Records are kept in fixed-size segments behind a ring of slots that is
+// allocated once, so a record never moves after it has been written. Indices
+// are absolute and keep growing; once more than MaxLines (or, without a
+// limit, MaxRetention) are stored, whole segments are evicted from the front.
+//
+// Only the UI thread writes. Background readers hold a ReadGuard while they
+// touch records and may look at anything in [OldestShared(), PublishedSize()).
+// Evicted segments and chunks are only freed once no reader is active.
+class LogStore {
+  static constexpr uint32_t SegmentShift = 16;
+  static constexpr uint32_t SegmentSize = 1u << SegmentShift;
+  static constexpr uint32_t MaxSegments = 1u << 15;
+
+  // every TimeGroupSize records share one full timestamp, the records only
+  // store a 16-bit delta to it; deltas that don't fit go to TimeOverflow
+  static constexpr uint32_t TimeGroupShift = 8;
+  static constexpr uint32_t TimeGroupSize = 1u << TimeGroupShift;
+  static constexpr uint16_t TimeOverflowMark = 0xFFFF;
+
+  struct Segment {
+    LogRecord records[SegmentSize];
+    int64_t groupBase[SegmentSize / TimeGroupSize];
+  };
+
+  std::unique_ptr<std::unique_ptr<Segment>[]> Segments;
+  std::unordered_map<size_t, int64_t> TimeOverflow;
+  size_t First = 0;
+  size_t Count = 0;
+  std::atomic<size_t> FirstShared{0};
+  std::atomic<size_t> Published{0};
+  mutable std::atomic<int> Readers{0};
+  LogArena Arena;
+
+  std::vector<size_t> RetiredSegments;
+  std::vector<uint32_t> RetiredChunks;
+
+  void EvictOldestSegment() {
+    RetiredSegments.push_back(First >> SegmentShift);
+    First += SegmentSize;
+    FirstShared.store(First);
+    Arena.Retire(First, RetiredChunks);
+    for (auto it = TimeOverflow.begin(); it != TimeOverflow.end();) {
+      if (it->first < First)
+        it = TimeOverflow.erase(it);
+      else
+        ++it;
+    }
+  }
+
+public:
+  static constexpr size_t MaxRetention =
+      (size_t)(MaxSegments - 2) * SegmentSize;
+
+  LogCategoryTable Categories;
+  size_t MaxLines = 0; // 0 = keep as many as the ring holds
+
+  class ReadGuard {
+    const LogStore &store;
+
+  public:
+    ReadGuard(const LogStore &s) : store(s) { store.Readers++; }
+    ~ReadGuard() { store.Readers--; }
+  };
+
+  LogStore()
+      : Segments(std::make_unique<std::unique_ptr<Segment>[]>(MaxSegments)) {}
+
+  // callers must make sure no background reader is active
+  void Clear() {
+    for (size_t i = 0; i < MaxSegments; i++)
+      Segments[i].reset();
+    RetiredSegments.clear();
+    RetiredChunks.clear();
+    TimeOverflow.clear();
+    First = Count = 0;
+    FirstShared = 0;
+    Published = 0;
+    Arena.Clear();
+    Categories.Clear();
+  }
+
+  size_t Add(const std::string &msg, const std::string &category,
+             uint32_t color, int64_t timeMs) {
+    auto &segment = Segments[(Count >> SegmentShift) % MaxSegments];
+    if ((Count & (SegmentSize - 1)) == 0) {
+      // the ring wrapped onto a slot that is still waiting to be freed
+      while (segment) {
+        ReleaseRetired();
+        std::this_thread::yield();
+      }
+      segment = std::make_unique<Segment>();
+    }
+
+    uint32_t slot = Count & (SegmentSize - 1);
+    LogRecord &rec = segment->records[slot];
+    // resident memory only grows when a chunk is started, which is the
+    // only time a line can push it over the budget
+    bool newChunk =
+        Arena.Append(msg.data(), msg.size(), Count, rec.chunk, rec.offset);
+    rec.length = (uint32_t)msg.size();
+    rec.category = Categories.Intern(category);
+    rec.color = color;
+
+    int64_t &base = segment->groupBase[slot >> TimeGroupShift];
+    if ((slot & (TimeGroupSize - 1)) == 0)
+      base = timeMs;
+    int64_t delta = timeMs - base;
+    if (delta >= 0 && delta < TimeOverflowMark) {
+      rec.timeDelta = (uint16_t)delta;
+    } else {
+      rec.timeDelta = TimeOverflowMark;
+      TimeOverflow[Count] = timeMs;
+    }
+
+    Count++;
+    Published.store(Count, std::memory_order_release);
+
+    size_t limit = MaxLines ? std::min(MaxLines, MaxRetention) : MaxRetention;
+    while (Count - First > limit + SegmentSize)
+      EvictOldestSegment();
+    if (newChunk)
+      Arena.EnforceBudget();
+    ReleaseRetired();
+
+    return Count - 1;
+  }
+
+  // frees evicted memory once no background reader can still see it
+  void ReleaseRetired() {
+    bool dropped = Arena.HasDropped();
+    if (RetiredSegments.empty() && RetiredChunks.empty() && !dropped)
+      return;
+    if (Readers.load() != 0)
+      return;
+    for (size_t seg : RetiredSegments)
+      Segments[seg % MaxSegments].reset();
+    for (uint32_t chunk : RetiredChunks)
+      Arena.Release(chunk);
+    RetiredSegments.clear();
+    RetiredChunks.clear();
+    if (dropped)
+      Arena.ReleaseDropped();
+  }
+
+  // Message bytes above this are paged out to a scratch file, least
+  // recently read first, and paged back in when a row is drawn or a filter
+  // reads it. 0 keeps everything in memory. Records stay resident.
+  void SetMemoryBudget(size_t bytes) {
+    Arena.SetBudget(bytes);
+    Arena.EnforceBudget();
+  }
+  size_t MemoryBudget() const { return Arena.Budget(); }
+  size_t SpilledBytes() const { return Arena.SpilledBytes(); }
+
+  // once per frame: pages out what the last frame's readers brought back in
+  // and frees what nobody can see any more
+  void Maintain() {
+    Arena.Tick();
+    Arena.EnforceBudget();
+    ReleaseRetired();
+  }
+
+  // valid indices are [Begin(), End())
+  size_t Begin() const { return First; }
+  size_t End() const { return Count; }
+  size_t Size() const { return Count - First; }
+  bool Empty() const { return Count == First; }
+  bool Contains(size_t idx) const { return idx >= First && idx < Count; }
+
+  // what a background reader may safely access
+  size_t OldestShared() const { return FirstShared.load(); }
+  size_t PublishedSize() const {
+    return Published.load(std::memory_order_acquire);
+  }
+
+  const LogRecord &operator[](size_t idx) const {
+    return Segments[(idx >> SegmentShift) % MaxSegments]
+        ->records[idx & (SegmentSize - 1)];
+  }
+
+  // receive time of a line in milliseconds since the epoch (UI thread only)
+  int64_t Time(size_t idx) const {
+    const Segment &segment = *Segments[(idx >> SegmentShift) % MaxSegments];
+    uint32_t slot = idx & (SegmentSize - 1);
+    uint16_t delta = segment.records[slot].timeDelta;
+    if (delta == TimeOverflowMark) {
+      auto it = TimeOverflow.find(idx);
+      return it == TimeOverflow.end() ? 0 : it->second;
+    }
+    return segment.groupBase[slot >> TimeGroupShift] + delta;
+  }
+
+  std::string_view Message(const LogRecord &rec) const {
+    return std::string_view(Arena.Get(rec.chunk, rec.offset), rec.length);
+  }
+
+  const char *MessageCStr(const LogRecord &rec) const {
+    return Arena.Get(rec.chunk, rec.offset);
+  }
+
+  const std::string &Category(const LogRecord &rec) const {
+    return Categories.Name(rec.category);
+  }
+
+  size_t MemoryUsage() const {
+    size_t segments = ((Count + SegmentSize - 1) >> SegmentShift) -
+                      (First >> SegmentShift);
+    return segments * sizeof(Segment) + Arena.MemoryUsage();
+  }
+};
@@ -0,0 +1,230 @@
+#pragma once
+#include "AhoCorasick.hpp"
+#include "TextMatch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct LogTrigger {
+  int Id = 0;
+  std::string Pattern;
+  bool Highlight = true;
+  bool Count = true;
+  bool Pause = false;
+  bool ToPane = true;
+  uint32_t HighlightColor = 0x5000A0FF; // packed ImU32, translucent orange
+  size_t Hits = 0;
+};
+
+struct LogTriggerHit {
+  int TriggerId;
+  int64_t TimeMs;
+  std::string Channel;
+  std::string Message;
+};
+
+// Set of patterns every incoming game log line is checked against. All
+// patterns are compiled into one Aho-Corasick automaton, so a line is
+// scanned once regardless of how many triggers exist. Editing the set
+// rebuilds the automaton on a background thread; the old one keeps matching
+// until the new one is swapped in.
+class LogTriggers {
+  struct Compiled {
+    AhoCorasick automaton;
+    std::vector<int> triggerIds; // pattern index -> trigger id
+    uint64_t generation = 0;
+  };
+
+  std::vector<LogTrigger> Triggers;
+  std::unordered_map<int, size_t> IndexById;
+  int NextId = 1;
+
+  // UI side copy, only replaced in Scan()
+  std::shared_ptr<const Compiled> Active;
+
+  std::thread Builder;
+  std::mutex BuildMutex;
+  std::condition_variable BuildCv;
+  bool Running = true;
+  std::vector<std::string> RequestPatterns;
+  std::vector<int> RequestIds;
+  uint64_t RequestGeneration = 0;
+  bool HasRequest = false;
+  std::shared_ptr<const Compiled> Built;
+  std::atomic<bool> HasBuilt{false};
+
+  uint64_t Generation = 0;
+  std::vector<int32_t> ScanScratch;
+
+  void BuilderLoop() {
+    while (true) {
+      std::vector<std::string> patterns;
+      std::vector<int> ids;
+      uint64_t generation;
+      {
+        std::unique_lock<std::mutex> lock(BuildMutex);
+        BuildCv.wait(lock, [this] { return !Running || HasRequest; });
+        if (!Running)
+          return;
+        patterns.swap(RequestPatterns);
+        ids.swap(RequestIds);
+        generation = RequestGeneration;
+        HasRequest = false;
+      }
+
+      auto compiled = std::make_shared<Compiled>();
+      compiled->automaton.Build(patterns);
+      compiled->triggerIds = std::move(ids);
+      compiled->generation = generation;
+
+      std::lock_guard<std::mutex> lock(BuildMutex);
+      // a newer request supersedes this result
+      if (HasRequest)
+        continue;
+      Built = std::move(compiled);
+      HasBuilt = true;
+    }
+  }
+
+  void Reindex() {
+    IndexById.clear();
+    for (size_t i = 0; i < Triggers.size(); i++)
+      IndexById[Triggers[i].Id] = i;
+  }
+
+  void RequestRebuild() {
+    Reindex();
+    std::lock_guard<std::mutex> lock(BuildMutex);
+    RequestPatterns.clear();
+    RequestIds.clear();
+    for (const auto &t : Triggers) {
+      if (t.Pattern.empty())
+        continue;
+      RequestPatterns.push_back(TextMatch::FoldCopy(t.Pattern));
+      RequestIds.push_back(t.Id);
+    }
+    RequestGeneration = ++Generation;
+    HasRequest = true;
+    BuildCv.notify_one();
+  }
+
+public:
+  // hits that asked to be shown in the trigger pane, newest last
+  std::deque<LogTriggerHit> PaneHits;
+  size_t MaxPaneHits = 5000;
+
+  std::function<void(const LogTrigger &, const std::string &)> OnPause;
+
+  LogTriggers() { Builder = std::thread(&LogTriggers::BuilderLoop, this); }
+
+  ~LogTriggers() {
+    {
+      std::lock_guard<std::mutex> lock(BuildMutex);
+      Running = false;
+    }
+    BuildCv.notify_all();
+    if (Builder.joinable())
+      Builder.join();
+  }
+
+  const std::vector<LogTrigger> &List() const { return Triggers; }
+
+  int Add(const std::string &pattern) {
+    LogTrigger t;
+    t.Id = NextId++;
+    t.Pattern = pattern;
+    Triggers.push_back(t);
+    RequestRebuild();
+    return t.Id;
+  }
+
+  void Remove(int id) {
+    Triggers.erase(std::remove_if(Triggers.begin(), Triggers.end(),
+                                  [id](const LogTrigger &t) {
+                                    return t.Id == id;
+                                  }),
+                   Triggers.end());
+    RequestRebuild();
+  }
+
+  void SetPattern(int id, const std::string &pattern) {
+    LogTrigger *t = Find(id);
+    if (!t || t->Pattern == pattern)
+      return;
+    t->Pattern = pattern;
+    RequestRebuild();
+  }
+
+  // action flags and counters can be edited in place, only the pattern needs
+  // a rebuild
+  LogTrigger *Find(int id) {
+    auto it = IndexById.find(id);
+    return it == IndexById.end() ? nullptr : &Triggers[it->second];
+  }
+
+  // true until the automaton for the latest edit is in use
+  bool IsRebuilding() const {
+    return Active ? Active->generation != Generation : Generation != 0;
+  }
+
+  size_t StateCount() const {
+    return Active ? Active->automaton.StateCount() : 0;
+  }
+
+  void ResetCounts() {
+    for (auto &t : Triggers)
+      t.Hits = 0;
+    PaneHits.clear();
+  }
+
+  // Matches one line against every trigger and runs the count, pane and
+  // pause actions. Returns the highlight colour of the first highlighting
+  // trigger that hit, or 0.
+  uint32_t Scan(const std::string &channel, const std::string &msg,
+                int64_t timeMs) {
+    if (HasBuilt.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(BuildMutex);
+      Active = std::move(Built);
+      HasBuilt = false;
+    }
+    if (!Active || Active->triggerIds.empty())
+      return 0;
+
+    ScanScratch.clear();
+    Active->automaton.Scan(msg, ScanScratch);
+    if (ScanScratch.empty())
+      return 0;
+
+    std::sort(ScanScratch.begin(), ScanScratch.end());
+    ScanScratch.erase(std::unique(ScanScratch.begin(), ScanScratch.end()),
+                      ScanScratch.end());
+
+    uint32_t highlight = 0;
+    for (int32_t pattern : ScanScratch) {
+      LogTrigger *t = Find(Active->triggerIds[pattern]);
+      if (!t)
+        continue;
+      if (t->Count)
+        t->Hits++;
+      if (t->Highlight && highlight == 0)
+        highlight = t->HighlightColor;
+      if (t->ToPane) {
+        PaneHits.push_back({t->Id, timeMs, channel, msg});
+        if (PaneHits.size() > MaxPaneHits)
+          PaneHits.pop_front();
+      }
+      if (t->Pause && OnPause)
+        OnPause(*t, msg);
+    }
+    return highlight;
+  }
+};
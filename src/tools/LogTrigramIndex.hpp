@@ -0,0 +1,198 @@
+#pragma once
+#include "LogQuery.hpp"
+#include "LogStore.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index from case-folded 3-byte sequences to the lines containing
+// them. Updated on the UI thread as lines arrive, so a substring query can
+// intersect a few posting lists instead of scanning every line; the result is
+// only a candidate set and still has to be verified against the real query.
+class LogTrigramIndex {
+  // Ids are stored as offsets from Base, which moves up as old lines are
+  // evicted. The store never keeps more than MaxRetention (< 2^31) lines,
+  // so live offsets always fit 32 bits however long the session runs.
+  struct Postings {
+    std::vector<uint32_t> ids;
+    // entries before head belong to evicted lines
+    size_t head = 0;
+  };
+
+  std::unordered_map<uint32_t, Postings> Lists;
+  size_t LivePostings = 0;
+  size_t Base = 0;
+
+  static constexpr size_t RebaseAfter = (size_t)1 << 31;
+  static_assert(LogStore::MaxRetention < RebaseAfter,
+                "live lines must fit a 32-bit offset after a rebase");
+
+  // after eviction every stored id is >= firstLive - Base
+  void Rebase(size_t firstLive) {
+    uint32_t delta = (uint32_t)(firstLive - Base);
+    for (auto &[key, p] : Lists) {
+      p.ids.erase(p.ids.begin(), p.ids.begin() + p.head);
+      p.head = 0;
+      for (auto &id : p.ids)
+        id -= delta;
+    }
+    Base = firstLive;
+  }
+
+  uint32_t Offset(size_t idx) const {
+    return idx < Base ? 0 : (uint32_t)(idx - Base);
+  }
+
+  static uint32_t Fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  }
+
+  static uint32_t Key(const char *p) {
+    return (Fold(p[0]) << 16) | (Fold(p[1]) << 8) | Fold(p[2]);
+  }
+
+  const Postings *Find(uint32_t key) const {
+    auto it = Lists.find(key);
+    return it == Lists.end() ? nullptr : &it->second;
+  }
+
+  // lines containing every trigram of the term, sorted
+  void TermCandidates(std::string_view term, size_t firstLive,
+                      std::vector<size_t> &out) const {
+    std::vector<const Postings *> lists;
+    for (size_t i = 0; i + 3 <= term.size(); i++) {
+      const Postings *p = Find(Key(term.data() + i));
+      if (!p) {
+        out.clear();
+        return;
+      }
+      lists.push_back(p);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const Postings *a, const Postings *b) {
+                return a->ids.size() - a->head < b->ids.size() - b->head;
+              });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    const auto &smallest = lists[0]->ids;
+    auto from = std::lower_bound(smallest.begin() + lists[0]->head,
+                                 smallest.end(), Offset(firstLive));
+    out.clear();
+    for (auto it = from; it != smallest.end(); ++it)
+      out.push_back(Base + *it);
+
+    for (size_t l = 1; l < lists.size() && !out.empty(); l++) {
+      const auto &ids = lists[l]->ids;
+      auto it = ids.begin() + lists[l]->head;
+      size_t kept = 0;
+      for (size_t id : out) {
+        it = std::lower_bound(it, ids.end(), Offset(id));
+        if (it == ids.end())
+          break;
+        if (Base + *it == id)
+          out[kept++] = id;
+      }
+      out.resize(kept);
+    }
+  }
+
+public:
+  // Off unless asked for: a posting per distinct trigram is ~3.5x the text
+  // it indexes, far more than the line records themselves.
+  bool Enabled = false;
+
+  void Clear() {
+    Lists.clear();
+    LivePostings = 0;
+    Base = 0;
+  }
+
+  void Add(size_t idx, std::string_view text) {
+    if (!Enabled || text.size() < 3)
+      return;
+    if (Lists.empty())
+      Base = idx; // e.g. rebuilt from a store that already evicted lines
+    uint32_t id = Offset(idx);
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+      auto &ids = Lists[Key(text.data() + i)].ids;
+      // a trigram repeated within the same line is only stored once
+      if (ids.empty() || ids.back() != id) {
+        ids.push_back(id);
+        LivePostings++;
+      }
+    }
+  }
+
+  // Drops postings for lines that were evicted from the store. Lists are
+  // only compacted once most of them is dead, so this stays cheap.
+  void Evict(size_t firstLive) {
+    uint32_t first = Offset(firstLive);
+    for (auto it = Lists.begin(); it != Lists.end();) {
+      Postings &p = it->second;
+      size_t head =
+          std::lower_bound(p.ids.begin() + p.head, p.ids.end(), first) -
+          p.ids.begin();
+      LivePostings -= head - p.head;
+      p.head = head;
+
+      if (p.head == p.ids.size()) {
+        it = Lists.erase(it);
+        continue;
+      }
+      if (p.head > p.ids.size() / 2) {
+        p.ids.erase(p.ids.begin(), p.ids.begin() + p.head);
+        p.head = 0;
+      }
+      ++it;
+    }
+    if (firstLive - std::min(firstLive, Base) >= RebaseAfter)
+      Rebase(firstLive);
+  }
+
+  // The index can only answer queries where every matching line has to
+  // contain one of the include terms. Terms shorter than a trigram, or a
+  // category that matches by name, need a full scan.
+  bool CanAnswer(const LogQuery &query) const {
+    if (!Enabled || query.IncludeTerms().empty() ||
+        query.AnyCategoryPasses())
+      return false;
+    for (const auto &term : query.IncludeTerms()) {
+      if (term.size() < 3)
+        return false;
+    }
+    return true;
+  }
+
+  // Sorted list of lines that may match the query, restricted to
+  // [firstLive, end). Only valid when CanAnswer() returned true.
+  std::vector<size_t> Candidates(const LogQuery &query, size_t firstLive,
+                                 size_t end) const {
+    std::vector<size_t> result;
+    std::vector<size_t> termIds;
+    std::vector<size_t> merged;
+
+    for (const auto &term : query.IncludeTerms()) {
+      TermCandidates(term, firstLive, termIds);
+      merged.clear();
+      std::set_union(result.begin(), result.end(), termIds.begin(),
+                     termIds.end(), std::back_inserter(merged));
+      result.swap(merged);
+    }
+
+    auto last = std::lower_bound(result.begin(), result.end(), end);
+    result.erase(last, result.end());
+    return result;
+  }
+
+  size_t MemoryUsage() const {
+    size_t bytes = Lists.size() * (sizeof(Postings) + 2 * sizeof(void *));
+    for (const auto &[key, p] : Lists)
+      bytes += p.ids.capacity() * sizeof(uint32_t);
+    return bytes;
+  }
+
+  size_t PostingCount() const { return LivePostings; }
+};
@@ -0,0 +1,953 @@
+#pragma once
+#include "Luacheck.hpp"
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// In-process lint of Lua 5.1 source: one pass of a hand-written lexer and
+// recursive descent parser that tracks scopes instead of building a tree.
+// It covers what matters while typing (syntax errors, undefined globals,
+// unused locals, shadowing) in well under a millisecond, with the same
+// codes and messages luacheck uses, so luacheck can stay the deep pass.
+namespace LuaLint {
+
+struct Options {
+  // globals that may be read, as declared in the generated .luacheckrc;
+  // empty means all are known
+  std::function<bool(const std::string &)> isKnownGlobal;
+  std::unordered_set<int> ignore; // luacheck codes, e.g. 211
+};
+
+enum Token : int {
+  // single char tokens are their char
+  TkAnd = 257,
+  TkBreak,
+  TkDo,
+  TkElse,
+  TkElseif,
+  TkEnd,
+  TkFalse,
+  TkFor,
+  TkFunction,
+  TkIf,
+  TkIn,
+  TkLocal,
+  TkNil,
+  TkNot,
+  TkOr,
+  TkRepeat,
+  TkReturn,
+  TkThen,
+  TkTrue,
+  TkUntil,
+  TkWhile,
+  TkConcat,
+  TkDots,
+  TkEq,
+  TkGe,
+  TkLe,
+  TkNe,
+  TkNumber,
+  TkName,
+  TkString,
+  TkEof
+};
+
+// spelling of the tokens from TkAnd on
+static const char *const TokenNames[] = {
+    "and",  "break", "do",     "else",   "elseif", "end",  "false",
+    "for",  "function", "if",  "in",     "local",  "nil",  "not",
+    "or",   "repeat", "return", "then",  "true",   "until", "while",
+    "..",   "...",   "==",     ">=",     "<=",     "~=",   "<number>",
+    "<name>", "<string>", "<eof>"};
+
+struct Lexeme {
+  int kind = TkEof;
+  std::string_view text;
+  int line = 1, col = 1;
+};
+
+struct SyntaxError {
+  std::string message;
+  int line, col, endCol;
+};
+
+class Lexer {
+  std::string_view Src;
+  size_t Pos = 0;
+  size_t LineStart = 0;
+  int Line = 1;
+
+  static bool IsAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  }
+  static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+  static bool IsAlnum(char c) { return IsAlpha(c) || IsDigit(c); }
+
+  char At(size_t i) const { return i < Src.size() ? Src[i] : '\0'; }
+
+  // errors point at where the token started, which for long strings may
+  // be a few lines up
+  [[noreturn]] static void Fail(const std::string &message, int line,
+                                int col) {
+    throw SyntaxError{message, line, col, col};
+  }
+
+  int Col(size_t pos) const { return (int)(pos - LineStart) + 1; }
+
+  // \n, \r, \r\n and \n\r each end one line
+  void Newline() {
+    char c = Src[Pos++];
+    if ((At(Pos) == '\n' || At(Pos) == '\r') && At(Pos) != c)
+      Pos++;
+    Line++;
+    LineStart = Pos;
+  }
+
+  // "[", then "="s and "[" again; the level, or -1 if this isn't one
+  int LongBracket(size_t p) const {
+    int level = 0;
+    for (p++; At(p) == '='; p++)
+      level++;
+    return At(p) == '[' ? level : -1;
+  }
+
+  void LongString(int level, const char *what) {
+    int line = Line, col = Col(Pos);
+    Pos += (size_t)level + 2;
+    while (true) {
+      if (Pos >= Src.size())
+        Fail(std::string("unfinished long ") + what, line, col);
+      char c = Src[Pos];
+      if (c == '\n' || c == '\r') {
+        Newline();
+      } else if (c == ']') {
+        size_t p = Pos + 1;
+        int n = 0;
+        while (At(p) == '=') {
+          n++;
+          p++;
+        }
+        Pos = p;
+        if (n == level && At(p) == ']') {
+          Pos++;
+          return;
+        }
+      } else {
+        Pos++;
+      }
+    }
+  }
+
+  void QuotedString() {
+    int line = Line, col = Col(Pos);
+    char quote = Src[Pos++];
+    while (true) {
+      if (Pos >= Src.size() || Src[Pos] == '\n' || Src[Pos] == '\r')
+        Fail("unfinished string", line, col);
+      char c = Src[Pos];
+      if (c == quote) {
+        Pos++;
+        return;
+      }
+      if (c == '\\') {
+        Pos++;
+        if (Pos >= Src.size())
+          Fail("unfinished string", line, col);
+        if (Src[Pos] == '\n' || Src[Pos] == '\r')
+          Newline();
+        else
+          Pos++;
+      } else {
+        Pos++;
+      }
+    }
+  }
+
+  // what Lua 5.1 reads as one numeral, checked afterwards
+  void Number() {
+    size_t start = Pos;
+    while (IsDigit(At(Pos)) || At(Pos) == '.')
+      Pos++;
+    if (At(Pos) == 'e' || At(Pos) == 'E') {
+      Pos++;
+      if (At(Pos) == '+' || At(Pos) == '-')
+        Pos++;
+    }
+    while (IsAlnum(At(Pos)) || At(Pos) == '.')
+      Pos++;
+
+    std::string_view s = Src.substr(start, Pos - start);
+    size_t i = 0;
+    bool ok;
+    if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+      ok = s.find_first_not_of("0123456789abcdefABCDEF", 2) ==
+           std::string_view::npos;
+    } else {
+      size_t digits = 0;
+      while (i < s.size() && IsDigit(s[i])) {
+        i++;
+        digits++;
+      }
+      if (i < s.size() && s[i] == '.') {
+        i++;
+        while (i < s.size() && IsDigit(s[i])) {
+          i++;
+          digits++;
+        }
+      }
+      ok = digits > 0;
+      if (ok && i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < s.size() && (s[i] == '+' || s[i] == '-'))
+          i++;
+        ok = i < s.size() && IsDigit(s[i]);
+        while (i < s.size() && IsDigit(s[i]))
+          i++;
+      }
+      ok = ok && i == s.size();
+    }
+    if (!ok)
+      Fail("malformed number near '" + std::string(s) + "'", Line,
+           Col(start));
+  }
+
+  static int Keyword(std::string_view s) {
+    static const std::unordered_map<std::string_view, int> words = [] {
+      std::unordered_map<std::string_view, int> m;
+      for (int k = TkAnd; k <= TkWhile; k++)
+        m.emplace(TokenNames[k - TkAnd], k);
+      return m;
+    }();
+    auto it = words.find(s);
+    return it == words.end() ? TkName : it->second;
+  }
+
+public:
+  explicit Lexer(std::string_view src) : Src(src) {
+    // a "#!" first line is skipped like lua.c does
+    if (Src.size() >= 2 && Src[0] == '#' && Src[1] == '!') {
+      while (Pos < Src.size() && Src[Pos] != '\n' && Src[Pos] != '\r')
+        Pos++;
+    }
+  }
+
+  Lexeme Next() {
+    while (Pos < Src.size()) {
+      char c = Src[Pos];
+      if (c == '\n' || c == '\r') {
+        Newline();
+      } else if (c == ' ' || c == '\t' || c == '\v' || c == '\f') {
+        Pos++;
+      } else if (c == '-' && At(Pos + 1) == '-') {
+        Pos += 2;
+        int level = At(Pos) == '[' ? LongBracket(Pos) : -1;
+        if (level >= 0) {
+          LongString(level, "comment");
+        } else {
+          while (Pos < Src.size() && Src[Pos] != '\n' && Src[Pos] != '\r')
+            Pos++;
+        }
+      } else {
+        break;
+      }
+    }
+
+    Lexeme lx;
+    lx.line = Line;
+    lx.col = Col(Pos);
+    size_t start = Pos;
+    if (Pos >= Src.size()) {
+      lx.kind = TkEof;
+      return lx;
+    }
+
+    char c = Src[Pos];
+    int level;
+    if (IsAlpha(c)) {
+      while (IsAlnum(At(Pos)))
+        Pos++;
+      lx.kind = Keyword(Src.substr(start, Pos - start));
+    } else if (IsDigit(c) || (c == '.' && IsDigit(At(Pos + 1)))) {
+      Number();
+      lx.kind = TkNumber;
+    } else if (c == '"' || c == '\'') {
+      QuotedString();
+      lx.kind = TkString;
+    } else if (c == '[' && (level = LongBracket(Pos)) >= 0) {
+      LongString(level, "string");
+      lx.kind = TkString;
+    } else {
+      Pos++;
+      lx.kind = (unsigned char)c;
+      char n = At(Pos);
+      if (c == '.' && n == '.') {
+        Pos++;
+        lx.kind = TkConcat;
+        if (At(Pos) == '.') {
+          Pos++;
+          lx.kind = TkDots;
+        }
+      } else if (n == '=' && (c == '=' || c == '<' || c == '>' || c == '~')) {
+        Pos++;
+        lx.kind = c == '=' ? TkEq : c == '<' ? TkLe : c == '>' ? TkGe : TkNe;
+      }
+    }
+    lx.text = Src.substr(start, Pos - start);
+    return lx;
+  }
+};
+
+// The parser proper. Names are resolved as they are parsed; globals are
+// checked at the end, since a file may use a global it sets further down.
+class Checker {
+  enum VarKind { KindVariable, KindArgument, KindLoop, KindFunction };
+
+  struct Var {
+    std::string_view name;
+    int line, col;
+    VarKind kind;
+    int block, func;
+    bool read = false;
+    bool written = false; // assigned again after its declaration
+    bool implicit = false; // self of a method
+  };
+
+  struct Block {
+    size_t firstActive;
+    bool loop;
+  };
+
+  struct Func {
+    size_t firstBlock;
+    bool vararg;
+  };
+
+  struct GlobalUse {
+    std::string_view name;
+    int line, col;
+  };
+
+  // a suffixed expression as far as assignments care
+  struct Exp {
+    enum { Name, Index, Call, Other } kind = Other;
+    Lexeme name;
+  };
+
+  Lexer Lex;
+  Lexeme Tok, Ahead;
+  bool HasAhead = false;
+  const std::string &File;
+  const Options &Opts;
+  std::vector<LintResult> &Out;
+
+  std::vector<Var> Vars;
+  std::vector<size_t> Active; // in scope, innermost last
+  std::vector<Block> Blocks;
+  std::vector<Func> Funcs;
+  std::vector<GlobalUse> GlobalReads;
+
+  // nesting limit as in Lua (LUAI_MAXCCALLS), keeps the stack in bounds
+  static constexpr int MaxDepth = 200;
+  int Depth = 0;
+
+  struct Nested {
+    Checker &c;
+    explicit Nested(Checker &checker) : c(checker) {
+      if (++c.Depth > MaxDepth)
+        c.Fail("chunk has too many syntax levels");
+    }
+    ~Nested() { c.Depth--; }
+  };
+
+  void Report(int code, int line, int col, int endCol,
+              const std::string &message) {
+    if (Opts.ignore.count(code))
+      return;
+    Out.push_back({File, line, col, endCol, "W", message});
+  }
+
+  static std::string Quoted(std::string_view name) {
+    return "'" + std::string(name) + "'";
+  }
+
+  void Next() {
+    if (HasAhead) {
+      Tok = Ahead;
+      HasAhead = false;
+    } else {
+      Tok = Lex.Next();
+    }
+  }
+
+  const Lexeme &Peek() {
+    if (!HasAhead) {
+      Ahead = Lex.Next();
+      HasAhead = true;
+    }
+    return Ahead;
+  }
+
+  static std::string Describe(int kind) {
+    if (kind == TkName)
+      return "identifier";
+    if (kind == TkEof)
+      return "<eof>";
+    if (kind < TkAnd)
+      return "'" + std::string(1, (char)kind) + "'";
+    return "'" + std::string(TokenNames[kind - TkAnd]) + "'";
+  }
+
+  std::string Near() const {
+    if (Tok.kind == TkEof)
+      return "near <eof>";
+    return "near '" + std::string(Tok.text) + "'";
+  }
+
+  [[noreturn]] void Fail(const std::string &message) const {
+    int endCol = Tok.col + std::max(0, (int)Tok.text.size() - 1);
+    throw SyntaxError{message, Tok.line, Tok.col, endCol};
+  }
+
+  bool Accept(int kind) {
+    if (Tok.kind != kind)
+      return false;
+    Next();
+    return true;
+  }
+
+  void Expect(int kind) {
+    if (!Accept(kind))
+      Fail("expected " + Describe(kind) + " " + Near());
+  }
+
+  // closing token of a construct opened on another line
+  void ExpectClose(int kind, int open, int line) {
+    if (Accept(kind))
+      return;
+    if (line == Tok.line)
+      Fail("expected " + Describe(kind) + " " + Near());
+    Fail("expected " + Describe(kind) + " (to close " + Describe(open) +
+         " on line " + std::to_string(line) + ") " + Near());
+  }
+
+  Lexeme ExpectName() {
+    Lexeme name = Tok;
+    Expect(TkName);
+    return name;
+  }
+
+  // scopes
+
+  void OpenBlock(bool loop) { Blocks.push_back({Active.size(), loop}); }
+
+  void CloseBlock() {
+    for (size_t i = Blocks.back().firstActive; i < Active.size(); i++)
+      CheckUnused(Vars[Active[i]]);
+    Active.resize(Blocks.back().firstActive);
+    Blocks.pop_back();
+  }
+
+  void CheckUnused(const Var &v) {
+    if (v.read || v.implicit || v.name == "_")
+      return;
+    int endCol = v.col + (int)v.name.size() - 1;
+    std::string name = Quoted(v.name);
+    switch (v.kind) {
+    case KindArgument:
+      Report(212, v.line, v.col, endCol, "unused argument " + name);
+      break;
+    case KindLoop:
+      Report(213, v.line, v.col, endCol, "unused loop variable " + name);
+      break;
+    case KindFunction:
+      Report(211, v.line, v.col, endCol, "unused function " + name);
+      break;
+    default:
+      if (v.written)
+        Report(231, v.line, v.col, endCol,
+               "variable " + name + " is never accessed");
+      else
+        Report(211, v.line, v.col, endCol, "unused variable " + name);
+    }
+  }
+
+  void Declare(const Lexeme &name, VarKind kind, bool implicit = false) {
+    int block = (int)Blocks.size() - 1, func = (int)Funcs.size() - 1;
+    int prev = Resolve(name.text);
+    if (prev >= 0 && !implicit && name.text != "_" &&
+        !Vars[prev].implicit) {
+      const Var &p = Vars[prev];
+      int which = p.kind == KindArgument ? 2 : p.kind == KindLoop ? 3 : 1;
+      static const char *what[] = {"", "variable ", "argument ",
+                                   "loop variable "};
+      std::string n = Quoted(name.text);
+      std::string line = " on line " + std::to_string(p.line);
+      int endCol = name.col + (int)name.text.size() - 1;
+      if (p.block == block) {
+        static const char *as[] = {"", "", " as an argument",
+                                   " as a loop variable"};
+        Report(410 + which, name.line, name.col, endCol,
+               "variable " + n + " was previously defined" + as[which] +
+                   line);
+      } else if (p.func == func) {
+        Report(420 + which, name.line, name.col, endCol,
+               "shadowing definition of " + std::string(what[which]) + n +
+                   line);
+      } else {
+        Report(430 + which, name.line, name.col, endCol,
+               "shadowing upvalue " +
+                   std::string(which == 1 ? "" : what[which]) + n + line);
+      }
+    }
+    Var v;
+    v.name = name.text;
+    v.line = name.line;
+    v.col = name.col;
+    v.kind = kind;
+    v.block = block;
+    v.func = func;
+    v.implicit = implicit;
+    Active.push_back(Vars.size());
+    Vars.push_back(v);
+  }
+
+  int Resolve(std::string_view name) const {
+    for (size_t i = Active.size(); i-- > 0;) {
+      if (Vars[Active[i]].name == name)
+        return (int)Active[i];
+    }
+    return -1;
+  }
+
+  void Read(const Lexeme &name) {
+    int v = Resolve(name.text);
+    if (v >= 0)
+      Vars[v].read = true;
+    else
+      GlobalReads.push_back({name.text, name.line, name.col});
+  }
+
+  void Write(const Lexeme &name) {
+    int v = Resolve(name.text);
+    if (v >= 0)
+      Vars[v].written = true;
+  }
+
+  // grammar, following lparser.c of Lua 5.1
+
+  static bool BlockFollow(int kind) {
+    return kind == TkElse || kind == TkElseif || kind == TkEnd ||
+           kind == TkUntil || kind == TkEof;
+  }
+
+  void Statements() {
+    while (!BlockFollow(Tok.kind)) {
+      if (Tok.kind == TkReturn || Tok.kind == TkBreak) {
+        LastStatement();
+        return;
+      }
+      Statement();
+      Accept(';');
+    }
+  }
+
+  void LastStatement() {
+    if (Tok.kind == TkBreak) {
+      bool inLoop = false;
+      for (size_t i = Blocks.size(); i-- > Funcs.back().firstBlock;)
+        inLoop = inLoop || Blocks[i].loop;
+      if (!inLoop)
+        Fail("'break' is not inside a loop");
+      Next();
+    } else {
+      Next();
+      if (!BlockFollow(Tok.kind) && Tok.kind != ';')
+        ExpList();
+    }
+    Accept(';');
+  }
+
+  void Body(int line, bool method) {
+    Funcs.push_back({Blocks.size(), false});
+    OpenBlock(false);
+    if (method) {
+      Lexeme self;
+      self.text = "self";
+      self.line = line;
+      Declare(self, KindArgument, true);
+    }
+    Expect('(');
+    if (Tok.kind != ')') {
+      do {
+        if (Accept(TkDots)) {
+          Funcs.back().vararg = true;
+          break;
+        }
+        Declare(ExpectName(), KindArgument);
+      } while (Accept(','));
+    }
+    Expect(')');
+    Statements();
+    ExpectClose(TkEnd, TkFunction, line);
+    CloseBlock();
+    Funcs.pop_back();
+  }
+
+  void Block(bool loop) {
+    OpenBlock(loop);
+    Statements();
+    CloseBlock();
+  }
+
+  void Statement() {
+    Nested nested(*this);
+    int line = Tok.line;
+    switch (Tok.kind) {
+    case ';':
+      Next();
+      return;
+    case TkIf:
+      Next();
+      Expr();
+      Expect(TkThen);
+      Block(false);
+      while (Tok.kind == TkElseif) {
+        Next();
+        Expr();
+        Expect(TkThen);
+        Block(false);
+      }
+      if (Accept(TkElse))
+        Block(false);
+      ExpectClose(TkEnd, TkIf, line);
+      return;
+    case TkWhile:
+      Next();
+      Expr();
+      Expect(TkDo);
+      Block(true);
+      ExpectClose(TkEnd, TkWhile, line);
+      return;
+    case TkDo:
+      Next();
+      Block(false);
+      ExpectClose(TkEnd, TkDo, line);
+      return;
+    case TkFor:
+      For(line);
+      return;
+    case TkRepeat:
+      // the condition sees the body's locals
+      Next();
+      OpenBlock(true);
+      Statements();
+      ExpectClose(TkUntil, TkRepeat, line);
+      Expr();
+      CloseBlock();
+      return;
+    case TkFunction: {
+      Next();
+      Lexeme name = ExpectName();
+      bool method = false;
+      if (Tok.kind == '.' || Tok.kind == ':') {
+        Read(name);
+        while (Accept('.'))
+          ExpectName();
+        if (Accept(':')) {
+          ExpectName();
+          method = true;
+        }
+      } else {
+        Write(name);
+      }
+      Body(line, method);
+      return;
+    }
+    case TkLocal:
+      Next();
+      if (Accept(TkFunction)) {
+        Declare(ExpectName(), KindFunction);
+        Body(line, false);
+      } else {
+        std::vector<Lexeme> names;
+        do {
+          names.push_back(ExpectName());
+        } while (Accept(','));
+        if (Accept('='))
+          ExpList();
+        for (const auto &n : names)
+          Declare(n, KindVariable);
+      }
+      return;
+    default:
+      ExpStatement();
+    }
+  }
+
+  void For(int line) {
+    Next();
+    std::vector<Lexeme> names = {ExpectName()};
+    if (Accept('=')) {
+      Expr();
+      Expect(',');
+      Expr();
+      if (Accept(','))
+        Expr();
+    } else {
+      while (Accept(','))
+        names.push_back(ExpectName());
+      Expect(TkIn);
+      ExpList();
+    }
+    Expect(TkDo);
+    OpenBlock(true);
+    for (const auto &n : names)
+      Declare(n, KindLoop);
+    Block(false);
+    CloseBlock();
+    ExpectClose(TkEnd, TkFor, line);
+  }
+
+  void ExpStatement() {
+    Exp e;
+    SuffixedExp(e);
+    if (Tok.kind != '=' && Tok.kind != ',') {
+      if (e.kind != Exp::Call)
+        Fail("expected '=' " + Near());
+      return;
+    }
+    std::vector<Exp> targets = {e};
+    while (Accept(',')) {
+      SuffixedExp(e);
+      targets.push_back(e);
+    }
+    for (const auto &t : targets) {
+      if (t.kind != Exp::Name && t.kind != Exp::Index)
+        Fail("syntax error " + Near()); // e.g. f() = 1
+    }
+    Expect('=');
+    ExpList();
+    for (const auto &t : targets) {
+      if (t.kind == Exp::Name)
+        Write(t.name);
+    }
+  }
+
+  void ExpList() {
+    Expr();
+    while (Accept(','))
+      Expr();
+  }
+
+  // a bare name is left unresolved in e, the caller knows if it's read
+  void SuffixedExp(Exp &e) {
+    e = Exp();
+    if (Tok.kind == TkName) {
+      e.kind = Exp::Name;
+      e.name = Tok;
+      Next();
+    } else if (Accept('(')) {
+      Expr();
+      Expect(')');
+    } else {
+      Fail("unexpected symbol " + Near());
+    }
+    while (true) {
+      bool call = false;
+      switch (Tok.kind) {
+      case '.':
+        Next();
+        ExpectName();
+        break;
+      case '[':
+        Next();
+        Expr();
+        Expect(']');
+        break;
+      case ':':
+        Next();
+        ExpectName();
+        CallArgs();
+        call = true;
+        break;
+      case '(':
+      case TkString:
+      case '{':
+        CallArgs();
+        call = true;
+        break;
+      default:
+        return;
+      }
+      if (e.kind == Exp::Name)
+        Read(e.name);
+      e.kind = call ? Exp::Call : Exp::Index;
+    }
+  }
+
+  void CallArgs() {
+    if (Tok.kind == TkString) {
+      Next();
+    } else if (Tok.kind == '{') {
+      Table();
+    } else {
+      int line = Tok.line;
+      Expect('(');
+      if (Tok.kind != ')')
+        ExpList();
+      ExpectClose(')', '(', line);
+    }
+  }
+
+  void Table() {
+    int line = Tok.line;
+    Expect('{');
+    while (Tok.kind != '}') {
+      if (Tok.kind == TkName && Peek().kind == '=') {
+        Next();
+        Next();
+        Expr();
+      } else if (Accept('[')) {
+        Expr();
+        Expect(']');
+        Expect('=');
+        Expr();
+      } else {
+        Expr();
+      }
+      if (!Accept(',') && !Accept(';'))
+        break;
+    }
+    ExpectClose('}', '{', line);
+  }
+
+  void SimpleExp() {
+    switch (Tok.kind) {
+    case TkNumber:
+    case TkString:
+    case TkNil:
+    case TkTrue:
+    case TkFalse:
+      Next();
+      return;
+    case TkDots:
+      if (!Funcs.back().vararg)
+        Fail("cannot use '...' outside a vararg function");
+      Next();
+      return;
+    case '{':
+      Table();
+      return;
+    case TkFunction: {
+      int line = Tok.line;
+      Next();
+      Body(line, false);
+      return;
+    }
+    default: {
+      Exp e;
+      SuffixedExp(e);
+      if (e.kind == Exp::Name)
+        Read(e.name);
+    }
+    }
+  }
+
+  // left and right priority of a binary operator, 0 if it isn't one
+  static std::pair<int, int> Priority(int kind) {
+    switch (kind) {
+    case TkOr:
+      return {1, 1};
+    case TkAnd:
+      return {2, 2};
+    case '<':
+    case '>':
+    case TkLe:
+    case TkGe:
+    case TkNe:
+    case TkEq:
+      return {3, 3};
+    case TkConcat:
+      return {5, 4}; // right associative
+    case '+':
+    case '-':
+      return {6, 6};
+    case '*':
+    case '/':
+    case '%':
+      return {7, 7};
+    case '^':
+      return {10, 9}; // right associative
+    default:
+      return {0, 0};
+    }
+  }
+
+  static constexpr int UnaryPriority = 8;
+
+  void Expr(int limit = 0) {
+    Nested nested(*this);
+    if (Tok.kind == TkNot || Tok.kind == '-' || Tok.kind == '#') {
+      Next();
+      Expr(UnaryPriority);
+    } else {
+      SimpleExp();
+    }
+    for (auto p = Priority(Tok.kind); p.first > limit;
+         p = Priority(Tok.kind)) {
+      Next();
+      Expr(p.second);
+    }
+  }
+
+public:
+  Checker(std::string_view source, const std::string &file,
+          const Options &opts, std::vector<LintResult> &out)
+      : Lex(source), File(file), Opts(opts), Out(out) {}
+
+  void Run() {
+    size_t first = Out.size();
+    try {
+      Next();
+      Funcs.push_back({0, true});
+      Block(false);
+      if (Tok.kind != TkEof)
+        Fail("expected <eof> " + Near());
+    } catch (const SyntaxError &e) {
+      // like luacheck, a file that doesn't parse only gets the error
+      Out.resize(first);
+      Out.push_back({File, e.line, e.col, e.endCol, "E", e.message});
+      return;
+    }
+
+    if (Opts.isKnownGlobal) {
+      std::unordered_map<std::string_view, bool> known;
+      for (const auto &g : GlobalReads) {
+        auto [it, added] = known.try_emplace(g.name, true);
+        if (added)
+          it->second = Opts.isKnownGlobal(std::string(g.name));
+        if (!it->second)
+          Report(113, g.line, g.col, g.col + (int)g.name.size() - 1,
+                 "accessing undefined variable " + Quoted(g.name));
+      }
+    }
+    std::stable_sort(Out.begin() + first, Out.end(),
+                     [](const LintResult &a, const LintResult &b) {
+                       return a.line != b.line ? a.line < b.line
+                                               : a.startCol < b.startCol;
+                     });
+  }
+};
+
+// Appends the issues in source to out, reported under file.
+inline void Check(std::string_view source, const std::string &file,
+                  const Options &opts, std::vector<LintResult> &out) {
+  Checker(source, file, opts, out).Run();
+}
+
+} // namespace LuaLint
@@ -0,0 +1,142 @@
+#pragma once
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct LintResult {
+  std::string file;
+  int line;
+  int startCol;
+  int endCol;
+  std::string type;
+  std::string message;
+};
+
+// What every luacheck invocation shares: the command line around the
+// targets and parsing of its plain formatter output.
+namespace Luacheck {
+
+inline std::vector<std::string> Args(const std::vector<std::string> &targets,
+                                     const std::string &configPath) {
+  std::vector<std::string> args = {"luacheck"};
+  args.insert(args.end(), targets.begin(), targets.end());
+  args.insert(args.end(),
+              {"--no-color", "--formatter=plain", "--ranges", "--codes"});
+  if (!configPath.empty())
+    args.insert(args.end(), {"--config", configPath});
+  return args;
+}
+
+namespace detail {
+
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+         c == '\r';
+}
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// reads the digits at p into value, false on none or overflow
+inline bool Number(std::string_view s, size_t &p, int &value) {
+  if (p >= s.size() || !IsDigit(s[p]))
+    return false;
+  auto [end, ec] = std::from_chars(s.data() + p, s.data() + s.size(), value);
+  if (ec != std::errc())
+    return false;
+  p = (size_t)(end - s.data());
+  return true;
+}
+
+inline bool Expect(std::string_view s, size_t &p, char c) {
+  if (p >= s.size() || s[p] != c)
+    return false;
+  p++;
+  return true;
+}
+
+// ":<line>:<col>-<col>:" plus whitespace at colon, returning where the
+// text after it starts (0 when it isn't there)
+inline size_t Location(std::string_view s, size_t colon, LintResult &res) {
+  size_t p = colon + 1;
+  if (Number(s, p, res.line) && Expect(s, p, ':') &&
+      Number(s, p, res.startCol) && Expect(s, p, '-') &&
+      Number(s, p, res.endCol) && Expect(s, p, ':') && p < s.size() &&
+      IsSpace(s[p]))
+    return p;
+  return 0;
+}
+
+// The "[(W123) ]<message>" after a location at p, false when there's a CR
+// in it or the file part.
+inline bool Tail(std::string_view s, size_t colon, size_t p,
+                 LintResult &res) {
+  while (p < s.size() && IsSpace(s[p]))
+    p++;
+  res.type = "W";
+  // "(W123)" then whitespace, otherwise it's part of the message
+  size_t q = p + 2;
+  if (p < s.size() && s[p] == '(' && q < s.size() &&
+      (s[p + 1] == 'W' || s[p + 1] == 'E') && IsDigit(s[q])) {
+    while (q < s.size() && IsDigit(s[q]))
+      q++;
+    if (q + 1 < s.size() && s[q] == ')' && IsSpace(s[q + 1])) {
+      size_t m = q + 1;
+      while (m < s.size() && IsSpace(s[m]))
+        m++;
+      if (s.find('\r', m) == std::string_view::npos) {
+        res.type.assign(1, s[p + 1]);
+        p = m;
+      }
+    }
+  }
+  if (s.find('\r', p) != std::string_view::npos ||
+      s.substr(0, colon).find('\r') != std::string_view::npos)
+    return false;
+  res.message.assign(s.substr(p));
+  return true;
+}
+
+// One "<file>:<line>:<col>-<col>: [(W123) ]<message>" line. Matches what
+// the regex this replaced matched: the file part extends to the last
+// location in the line, and CRs are only allowed in whitespace.
+inline bool ParseLine(std::string_view s, const std::string &file,
+                      LintResult &res) {
+  size_t colon = s.size();
+  while (colon > 1) {
+    colon = s.rfind(':', colon - 1);
+    if (colon == std::string_view::npos || colon == 0)
+      return false;
+    size_t p = Location(s, colon, res);
+    if (p == 0 || !Tail(s, colon, p, res))
+      continue;
+    if (file.empty())
+      res.file.assign(s.substr(0, colon));
+    else
+      res.file = file;
+    return true;
+  }
+  return false;
+}
+
+} // namespace detail
+
+// Appends one result per issue line. With file set every result is
+// reported under it, otherwise under the path luacheck printed. A single
+// pass over the output; full project runs print tens of thousands of lines.
+inline void Parse(std::string_view output, const std::string &file,
+                  std::vector<LintResult> &results) {
+  LintResult res;
+  while (!output.empty()) {
+    size_t nl = output.find('\n');
+    std::string_view line = output.substr(0, nl);
+    output.remove_prefix(nl == std::string_view::npos ? output.size()
+                                                      : nl + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (detail::ParseLine(line, file, res))
+      results.push_back(res);
+  }
+}
+
+} // namespace Luacheck
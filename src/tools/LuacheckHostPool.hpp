@@ -0,0 +1,310 @@
+#pragma once
+#include "ChildProcess.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Lua side of a luacheck host: loads luacheck as a library once, then
+// answers framed requests on stdin with luacheck's plain output format.
+//
+//   CONFIG <n>\n<path>           (re)load options from a .luacheckrc
+//   LINT <n> <m>\n<name><source> lint source, report it under name
+//
+// Every request is answered with its output lines and a "\1END" line.
+// Sources reach us with LF line ends, as Windows text-mode stdin would eat
+// CRs and break the byte counts.
+//
+// The driver itself comes in over stdin too, read by LuacheckHostBootstrap,
+// so no script is ever read back from a (shared, writable) temp directory.
+static const char *LuacheckHostBootstrap =
+    "local n = tonumber(io.read('*l')) "
+    "assert((loadstring or load)(io.read(n), '=driver'))()";
+
+static const char *LuacheckHostDriver = R"lua(
+local ok, luacheck = pcall(require, "luacheck")
+if not ok then
+  io.write("FAIL ", (tostring(luacheck):gsub("\n", " ")), "\n")
+  io.flush()
+  return
+end
+
+local options = {}
+
+local function load_config(path)
+  local env = {}
+  local chunk
+  if setfenv then
+    chunk = loadfile(path)
+    if chunk then setfenv(chunk, env) end
+  else
+    chunk = loadfile(path, "t", env)
+  end
+  options = {}
+  if chunk and pcall(chunk) then
+    for k, v in pairs(env) do
+      if k ~= "files" and k ~= "stds" and type(v) ~= "function" then
+        options[k] = v
+      end
+    end
+  end
+end
+
+local function lint(name, src)
+  local report = luacheck.check_strings({src}, options)[1]
+  for _, ev in ipairs(report) do
+    local kind = ev.code:sub(1, 1) == "0" and "E" or "W"
+    local col = ev.column or 1
+    io.write(string.format("%s:%d:%d-%d: (%s%s) %s\n", name, ev.line or 1,
+      col, ev.end_column or col, kind, ev.code, luacheck.get_message(ev)))
+  end
+  if report.fatal and #report == 0 then
+    io.write(name, ":1:1-1: (E011) ", tostring(report.msg or report.fatal),
+      "\n")
+  end
+end
+
+io.stdout:setvbuf("full")
+io.write("READY\n")
+io.flush()
+while true do
+  local header = io.read("*l")
+  if not header then break end
+  local cmd, a, b = header:match("^(%u+) (%d+) ?(%d*)")
+  if cmd == "CONFIG" then
+    load_config(io.read(tonumber(a)))
+  elseif cmd == "LINT" then
+    local name = io.read(tonumber(a))
+    local n = tonumber(b) or 0
+    local src = n > 0 and io.read(n) or ""
+    local done, err = pcall(lint, name, src)
+    if not done then
+      io.write("ERROR ", (tostring(err):gsub("\n", " ")), "\n")
+    end
+  end
+  io.write("\1END\n")
+  io.flush()
+end
+)lua";
+
+// One long-lived interpreter running the driver above.
+class LuacheckHost {
+  ChildProcess Proc;
+  bool Alive = false;
+  std::string Pending; // read but not yet consumed
+  std::string Config;
+  std::filesystem::file_time_type ConfigTime;
+
+  bool ReadLine(std::string &line) {
+    size_t nl;
+    while ((nl = Pending.find('\n')) == std::string::npos) {
+      char buf[4096];
+      size_t n = Proc.Read(buf, sizeof(buf));
+      if (n == 0)
+        return false;
+      Pending.append(buf, n);
+    }
+    line.assign(Pending, 0, nl);
+    Pending.erase(0, nl + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    return true;
+  }
+
+  bool Send(const std::string &data) {
+    return Proc.Write(data.data(), data.size());
+  }
+
+  // sends CONFIG when the path or the file's mtime changed since last time
+  bool SyncConfig(const std::string &configPath) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(configPath, ec);
+    if (configPath == Config && (ec || mtime == ConfigTime))
+      return true;
+    std::string line;
+    if (!Send("CONFIG " + std::to_string(configPath.size()) + "\n" +
+              configPath) ||
+        !ReadLine(line))
+      return false;
+    Config = configPath;
+    ConfigTime = mtime;
+    return true;
+  }
+
+public:
+  bool IsAlive() const { return Alive; }
+
+  bool Start(const std::string &lua) {
+    Stop();
+    Pending.clear();
+    Config.clear();
+    std::string line;
+    if (!Proc.Start({lua, "-e", LuacheckHostBootstrap}))
+      return false;
+    std::string driver = LuacheckHostDriver;
+    Alive = Send(std::to_string(driver.size()) + "\n" + driver) &&
+            ReadLine(line) && line == "READY";
+    if (!Alive)
+      Stop();
+    return Alive;
+  }
+
+  void Stop() {
+    Proc.CloseInput();
+    Proc.Kill();
+    Proc.Wait();
+    Alive = false;
+  }
+
+  // Appends luacheck's plain output for content to output. False when the
+  // host died, was cancelled (killed) or luacheck threw; the host is
+  // stopped in the first two cases.
+  bool Lint(const std::string &name, const std::string &content,
+            const std::string &configPath, std::string &output,
+            ProcessCancel *cancel = nullptr) {
+    if (!Alive)
+      return false;
+    if (cancel && !cancel->Attach(&Proc))
+      return false;
+    bool ok = Exchange(name, content, configPath, output);
+    if (cancel)
+      cancel->Detach();
+    if (!Alive)
+      Stop(); // reap it now that nobody can kill it any more
+    return ok;
+  }
+
+private:
+  bool Exchange(const std::string &name, const std::string &content,
+                const std::string &configPath, std::string &output) {
+    std::string source;
+    source.reserve(content.size());
+    for (char c : content) {
+      if (c != '\r')
+        source += c;
+    }
+    if (!SyncConfig(configPath) ||
+        !Send("LINT " + std::to_string(name.size()) + " " +
+              std::to_string(source.size()) + "\n" + name + source)) {
+      Alive = false;
+      return false;
+    }
+    bool ok = true;
+    std::string line;
+    while (true) {
+      if (!ReadLine(line)) {
+        Alive = false;
+        return false;
+      }
+      if (line == "\1END")
+        return ok;
+      if (line.compare(0, 6, "ERROR ") == 0)
+        ok = false;
+      else
+        output += line + "\n";
+    }
+  }
+};
+
+// A few luacheck hosts kept running between lints, so a lint costs a
+// request over a pipe instead of a process and VM start. Dead hosts are
+// restarted on their next use. If hosts cannot be started at all (no Lua,
+// or luacheck not installed as a library, e.g. the Windows luacheck.exe)
+// the pool disables itself and callers go back to one process per lint.
+class LuacheckHostPool {
+  std::mutex Mutex;
+  std::condition_variable Cv;
+  std::vector<std::unique_ptr<LuacheckHost>> Hosts;
+  std::vector<bool> Busy;
+  std::string LuaCommand = "lua";
+  int FailedStarts = 0;
+  bool Disabled = false;
+
+  static constexpr int MaxFailedStarts = 3;
+
+  // a free host that is already running if there is one, so a host that
+  // was just killed doesn't make the next lint wait for a restart
+  int Acquire() {
+    std::unique_lock<std::mutex> lock(Mutex);
+    Cv.wait(lock, [this] {
+      return Disabled ||
+             std::find(Busy.begin(), Busy.end(), false) != Busy.end();
+    });
+    if (Disabled)
+      return -1;
+    int idx = -1;
+    for (int i = 0; i < (int)Busy.size(); i++) {
+      if (Busy[i])
+        continue;
+      if (idx < 0 || (Hosts[i]->IsAlive() && !Hosts[idx]->IsAlive()))
+        idx = i;
+    }
+    Busy[idx] = true;
+    return idx;
+  }
+
+  void Release(int idx) {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Busy[idx] = false;
+    }
+    Cv.notify_one();
+  }
+
+  // starts the host if needed, outside the lock
+  bool EnsureRunning(LuacheckHost &host) {
+    if (host.IsAlive())
+      return true;
+    bool started = host.Start(LuaCommand);
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (started) {
+      FailedStarts = 0;
+      return true;
+    }
+    if (++FailedStarts >= MaxFailedStarts) {
+      Disabled = true;
+      Cv.notify_all();
+    }
+    return false;
+  }
+
+public:
+  explicit LuacheckHostPool(size_t size = 2) {
+    for (size_t i = 0; i < size; i++)
+      Hosts.push_back(std::make_unique<LuacheckHost>());
+    Busy.assign(size, false);
+  }
+
+  bool IsEnabled() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return !Disabled;
+  }
+
+  // False when no host could serve the request; output is then untouched
+  // and the caller should run luacheck itself (unless it cancelled). A host
+  // that dies mid-lint is restarted and the lint retried once.
+  bool Lint(const std::string &name, const std::string &content,
+            const std::string &configPath, std::string &output,
+            ProcessCancel *cancel = nullptr) {
+    int idx = Acquire();
+    if (idx < 0)
+      return false;
+    LuacheckHost &host = *Hosts[idx];
+    bool ok = false;
+    for (int attempt = 0; attempt < 2 && !ok; attempt++) {
+      if (!EnsureRunning(host))
+        break;
+      std::string result;
+      ok = host.Lint(name, content, configPath, result, cancel);
+      if (ok)
+        output += result;
+      else if (host.IsAlive() || (cancel && cancel->IsCancelled()))
+        break; // luacheck itself failed or we were told to stop
+    }
+    Release(idx);
+    return ok;
+  }
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. Pages are only read from disk
+// when touched, so opening a multi-GB file costs nothing up front.
+class MappedFile {
+  const uint8_t *Data = nullptr;
+  size_t Length = 0;
+#ifdef _WIN32
+  HANDLE File = INVALID_HANDLE_VALUE;
+  HANDLE Mapping = NULL;
+#else
+  int Fd = -1;
+#endif
+
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { Close(); }
+
+  bool Open(const std::string &path) {
+    Close();
+#ifdef _WIN32
+    File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (File == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(File, &size) || size.QuadPart == 0) {
+      Close();
+      return false;
+    }
+    Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!Mapping) {
+      Close();
+      return false;
+    }
+    Data = (const uint8_t *)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    Length = (size_t)size.QuadPart;
+#else
+    Fd = open(path.c_str(), O_RDONLY);
+    if (Fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(Fd, &st) != 0 || st.st_size == 0) {
+      Close();
+      return false;
+    }
+    void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+    if (p != MAP_FAILED) {
+      Data = (const uint8_t *)p;
+      Length = (size_t)st.st_size;
+    }
+#endif
+    if (!Data) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() {
+#ifdef _WIN32
+    if (Data)
+      UnmapViewOfFile(Data);
+    if (Mapping)
+      CloseHandle(Mapping);
+    if (File != INVALID_HANDLE_VALUE)
+      CloseHandle(File);
+    Mapping = NULL;
+    File = INVALID_HANDLE_VALUE;
+#else
+    if (Data)
+      munmap((void *)Data, Length);
+    if (Fd >= 0)
+      close(Fd);
+    Fd = -1;
+#endif
+    Data = nullptr;
+    Length = 0;
+  }
+
+  bool IsOpen() const { return Data != nullptr; }
+  const uint8_t *Bytes() const { return Data; }
+  size_t Size() const { return Length; }
+};
@@ -0,0 +1,178 @@
+#pragma once
+#include "TextMatch.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct PrefixEntry {
+  std::string text;
+  int kind = 0;    // caller defined, e.g. command / history / global
+  int payload = 0; // caller defined, e.g. index into its own table
+  uint64_t rank = 0;
+};
+
+// Case-folded trie for completion. Every node keeps the ids of the best
+// TopK entries below it, so a lookup is one walk down the prefix and never
+// looks at the entries themselves. Ranks may only go up (Touch), which keeps
+// those per-node lists exact without ever rescanning a subtree.
+class PrefixIndex {
+public:
+  static constexpr size_t TopK = 16;
+
+private:
+  struct Node {
+    std::vector<std::pair<char, uint32_t>> children; // sorted by char
+    std::vector<uint32_t> top;                       // best first
+    bool ends = false; // some entry ends here
+  };
+
+  std::vector<Node> Nodes = std::vector<Node>(1);
+  std::vector<PrefixEntry> Entries;
+  std::unordered_map<std::string, uint32_t> Lookup; // exact text -> id
+  std::unordered_map<std::string, uint32_t> FoldedLookup; // first added
+
+  // higher rank, then shorter, then alphabetical
+  bool Better(uint32_t a, uint32_t b) const {
+    const PrefixEntry &ea = Entries[a], &eb = Entries[b];
+    if (ea.rank != eb.rank)
+      return ea.rank > eb.rank;
+    if (ea.text.size() != eb.text.size())
+      return ea.text.size() < eb.text.size();
+    return ea.text < eb.text;
+  }
+
+  int FindChild(const Node &node, char c) const {
+    auto it = std::lower_bound(
+        node.children.begin(), node.children.end(), c,
+        [](const std::pair<char, uint32_t> &p, char v) { return p.first < v; });
+    if (it == node.children.end() || it->first != c)
+      return -1;
+    return (int)it->second;
+  }
+
+  uint32_t ChildOrCreate(uint32_t nodeIdx, char c) {
+    int found = FindChild(Nodes[nodeIdx], c);
+    if (found >= 0)
+      return (uint32_t)found;
+    uint32_t child = (uint32_t)Nodes.size();
+    Nodes.emplace_back();
+    auto &children = Nodes[nodeIdx].children;
+    auto it = std::lower_bound(
+        children.begin(), children.end(), c,
+        [](const std::pair<char, uint32_t> &p, char v) { return p.first < v; });
+    children.insert(it, {c, child});
+    return child;
+  }
+
+  // (re)places id in a node's list after its rank went up or it was added
+  void Offer(Node &node, uint32_t id) {
+    auto &top = node.top;
+    auto self = std::find(top.begin(), top.end(), id);
+    if (self != top.end())
+      top.erase(self);
+    else if (top.size() >= TopK && !Better(id, top.back()))
+      return;
+    auto at = std::find_if(top.begin(), top.end(),
+                           [&](uint32_t other) { return Better(id, other); });
+    top.insert(at, id);
+    if (top.size() > TopK)
+      top.pop_back();
+  }
+
+  template <typename Fn> void ForPath(const std::string &text, Fn &&fn) {
+    uint32_t node = 0;
+    fn(Nodes[node]);
+    for (char c : text) {
+      node = ChildOrCreate(node, TextMatch::Fold(c));
+      fn(Nodes[node]);
+    }
+  }
+
+public:
+  void Clear() {
+    Nodes.assign(1, Node());
+    Entries.clear();
+    Lookup.clear();
+    FoldedLookup.clear();
+  }
+
+  size_t Size() const { return Entries.size(); }
+  const PrefixEntry &Entry(uint32_t id) const { return Entries[id]; }
+
+  // returns -1 when the exact text was never added
+  int64_t Find(const std::string &text) const {
+    auto it = Lookup.find(text);
+    return it == Lookup.end() ? -1 : (int64_t)it->second;
+  }
+
+  // like Find(), ignoring case the way Query() does
+  int64_t FindFolded(std::string_view text) const {
+    auto it = FoldedLookup.find(TextMatch::FoldCopy(text));
+    return it == FoldedLookup.end() ? -1 : (int64_t)it->second;
+  }
+
+  // adding a text that is already there only raises its rank
+  uint32_t Add(const std::string &text, int kind, int payload,
+               uint64_t rank) {
+    int64_t existing = Find(text);
+    if (existing >= 0) {
+      Touch((uint32_t)existing, rank);
+      return (uint32_t)existing;
+    }
+    uint32_t id = (uint32_t)Entries.size();
+    Entries.push_back({text, kind, payload, rank});
+    Lookup.emplace(text, id);
+    FoldedLookup.emplace(TextMatch::FoldCopy(text), id);
+    Node *last = nullptr;
+    ForPath(text, [&](Node &node) {
+      Offer(node, id);
+      last = &node;
+    });
+    last->ends = true;
+    return id;
+  }
+
+  void Touch(uint32_t id, uint64_t rank) {
+    if (rank <= Entries[id].rank)
+      return;
+    Entries[id].rank = rank;
+    std::string text = Entries[id].text;
+    ForPath(text, [&](Node &node) { Offer(node, id); });
+  }
+
+  // best entries starting with prefix (any case), best first
+  const std::vector<uint32_t> &Query(std::string_view prefix) const {
+    static const std::vector<uint32_t> none;
+    uint32_t node = 0;
+    for (char c : prefix) {
+      int child = FindChild(Nodes[node], TextMatch::Fold(c));
+      if (child < 0)
+        return none;
+      node = (uint32_t)child;
+    }
+    return Nodes[node].top;
+  }
+
+  // Longest text every entry starting with prefix shares, spelled like the
+  // best of them. Equal to prefix's length when the entries diverge there.
+  std::string Extend(std::string_view prefix) const {
+    uint32_t node = 0;
+    for (char c : prefix) {
+      int child = FindChild(Nodes[node], TextMatch::Fold(c));
+      if (child < 0)
+        return std::string(prefix);
+      node = (uint32_t)child;
+    }
+    if (Nodes[node].top.empty())
+      return std::string(prefix);
+    size_t depth = prefix.size();
+    while (!Nodes[node].ends && Nodes[node].children.size() == 1) {
+      node = Nodes[node].children[0].second;
+      depth++;
+    }
+    return Entries[Nodes[node].top[0]].text.substr(0, depth);
+  }
+};
@@ -0,0 +1,253 @@
+#pragma once
+#include "ChildProcess.hpp"
+#include "LintCache.hpp"
+#include "Luacheck.hpp"
+#include "LuacheckHostPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Project-wide analysis: every .lua file under a folder is linted by a set
+// of worker threads that pull files off a shared counter, so a few slow
+// files don't hold up a fixed shard. Each thread goes through the luacheck
+// host pool, or runs the luacheck CLI on small batches of files when the
+// pool is unavailable. Results are handed over as soon as a file is done.
+// Files whose content and config were linted before come from the cache.
+class ProjectLint {
+  struct State {
+    std::vector<std::string> files;
+    std::string configPath;
+    std::atomic<bool> cancelled{false};
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::atomic<size_t> cached{0};
+    std::atomic<int> workers{0};
+    std::mutex mutex;
+    std::vector<LintResult> found; // handed over in Collect()
+  };
+
+  // files per CLI run: enough to amortize process start, small enough to
+  // keep results streaming and cancel responsive
+  static constexpr size_t CliBatch = 16;
+
+  std::shared_ptr<State> Job;
+  std::vector<std::thread> Threads;
+  LuacheckHostPool *Pool = nullptr;
+  LintCache *Cache = nullptr;
+
+  static bool ReadFile(const std::string &path, std::string &out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      return false;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    out = ss.str();
+    return true;
+  }
+
+  static void Publish(State &s, std::vector<LintResult> &results,
+                      size_t files) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.found.insert(s.found.end(), std::make_move_iterator(results.begin()),
+                   std::make_move_iterator(results.end()));
+    results.clear();
+    s.done += files;
+  }
+
+  // luacheck exits with 0-2 when it got through the files; anything else
+  // (or no luacheck at all) must not end up in the cache
+  static bool Linted(bool started, int exitCode) {
+    return started && exitCode >= 0 && exitCode <= 2;
+  }
+
+  static void LintOne(State &s, LuacheckHostPool *pool, LintCache *cache,
+                      const std::string &file,
+                      std::vector<LintResult> &results) {
+    std::string content;
+    if (ReadFile(file, content)) {
+      bool cached = false;
+      LintSource(pool, cache, file, content, s.configPath, results, &cached);
+      if (cached)
+        s.cached++;
+    } else {
+      // the CLI reports why it can't be read
+      std::string output;
+      ChildProcess::Run(Luacheck::Args({file}, s.configPath), "", output);
+      Luacheck::Parse(output, file, results);
+    }
+    Publish(s, results, 1);
+  }
+
+  static void LintBatch(State &s, LintCache *cache, size_t begin,
+                        size_t end, std::vector<LintResult> &results) {
+    std::vector<std::string> batch;
+    std::unordered_map<std::string, uint64_t> keys;
+    for (size_t i = begin; i < end; i++) {
+      const std::string &file = s.files[i];
+      std::string content;
+      if (cache && ReadFile(file, content)) {
+        uint64_t key = cache->Key(file, content);
+        if (cache->Get(key, file, results)) {
+          s.cached++;
+          continue;
+        }
+        keys[file] = key;
+      }
+      batch.push_back(file);
+    }
+    if (!batch.empty()) {
+      std::string output;
+      int exitCode = 0;
+      bool linted = Linted(
+          ChildProcess::Run(Luacheck::Args(batch, s.configPath), "", output,
+                            &exitCode),
+          exitCode);
+      size_t first = results.size();
+      Luacheck::Parse(output, "", results);
+      if (cache && linted) {
+        // luacheck reports files under the paths it was given
+        std::unordered_map<std::string, std::vector<LintResult>> perFile;
+        for (size_t i = first; i < results.size(); i++)
+          perFile[results[i].file].push_back(results[i]);
+        for (const auto &[file, key] : keys)
+          cache->Store(key, perFile[file]);
+      }
+    }
+    Publish(s, results, end - begin);
+  }
+
+  static void Work(std::shared_ptr<State> s, LuacheckHostPool *pool,
+                   LintCache *cache) {
+    std::vector<LintResult> results;
+    while (!s->cancelled) {
+      if (pool && pool->IsEnabled()) {
+        size_t i = s->next++;
+        if (i >= s->files.size())
+          break;
+        LintOne(*s, pool, cache, s->files[i], results);
+      } else {
+        size_t i = s->next.fetch_add(CliBatch);
+        if (i >= s->files.size())
+          break;
+        LintBatch(*s, cache, i, std::min(i + CliBatch, s->files.size()),
+                  results);
+      }
+    }
+    // the last one out keeps what this scan learned for the next session
+    if (--s->workers == 0 && cache)
+      cache->Save();
+  }
+
+  void Join() {
+    for (auto &t : Threads) {
+      if (t.joinable())
+        t.join();
+    }
+    Threads.clear();
+  }
+
+public:
+  // Lints content as file through the cache, a host or the CLI, appending
+  // to results. False when luacheck could not check it.
+  static bool LintSource(LuacheckHostPool *pool, LintCache *cache,
+                         const std::string &file, const std::string &content,
+                         const std::string &configPath,
+                         std::vector<LintResult> &results,
+                         bool *cached = nullptr) {
+    uint64_t key = cache ? cache->Key(file, content) : 0;
+    if (cache && cache->Get(key, file, results)) {
+      if (cached)
+        *cached = true;
+      return true;
+    }
+    std::string output;
+    int exitCode = 0;
+    bool linted = pool && pool->Lint(file, content, configPath, output);
+    if (!linted) {
+      output.clear();
+      auto args = Luacheck::Args({"-", "--filename", file}, configPath);
+      linted = Linted(ChildProcess::Run(args, content, output, &exitCode),
+                      exitCode);
+    }
+    if (!linted)
+      return false;
+    size_t first = results.size();
+    Luacheck::Parse(output, file, results);
+    if (cache)
+      cache->Store(key, std::vector<LintResult>(results.begin() + first,
+                                                results.end()));
+    return true;
+  }
+
+  ProjectLint(LuacheckHostPool *pool, LintCache *cache = nullptr)
+      : Pool(pool), Cache(cache) {}
+  ~ProjectLint() {
+    Cancel();
+    Join();
+  }
+
+  // threads = 0 picks one per core
+  void Start(const std::string &root, const std::string &configPath,
+             unsigned threads = 0) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+      if (it->is_regular_file(ec) && it->path().extension() == ".lua")
+        files.push_back(it->path().string());
+    }
+    std::sort(files.begin(), files.end());
+    StartFiles(std::move(files), configPath, threads);
+  }
+
+  // the same for a given list of files
+  void StartFiles(std::vector<std::string> files,
+                  const std::string &configPath, unsigned threads = 0) {
+    Cancel();
+    Join();
+
+    auto job = std::make_shared<State>();
+    job->configPath = configPath;
+    job->files = std::move(files);
+
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, job->files.size());
+    job->workers = (int)threads;
+    Job = job;
+    for (unsigned i = 0; i < threads; i++)
+      Threads.emplace_back(Work, job, Pool, Cache);
+  }
+
+  // workers stop after the file they are on and are joined by the next
+  // start, so cancelling never blocks the UI
+  void Cancel() {
+    if (Job)
+      Job->cancelled = true;
+  }
+
+  bool IsRunning() const { return Job && Job->workers > 0; }
+  bool WasCancelled() const { return Job && Job->cancelled; }
+  size_t FilesDone() const { return Job ? Job->done.load() : 0; }
+  size_t FilesTotal() const { return Job ? Job->files.size() : 0; }
+  size_t FilesCached() const { return Job ? Job->cached.load() : 0; }
+
+  // moves results found since the last call to the end of out
+  void Collect(std::vector<LintResult> &out) {
+    if (!Job)
+      return;
+    std::lock_guard<std::mutex> lock(Job->mutex);
+    out.insert(out.end(), std::make_move_iterator(Job->found.begin()),
+               std::make_move_iterator(Job->found.end()));
+    Job->found.clear();
+  }
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Set of row indices stored as sorted, disjoint, inclusive intervals. Selecting
+// a million rows is a single interval instead of a million tree nodes.
+class RangeSelection {
+public:
+  using Range = std::pair<int, int>;
+
+private:
+  std::vector<Range> Ranges;
+
+  // first range that ends at or after idx
+  std::vector<Range>::iterator LowerBound(int idx) {
+    return std::lower_bound(
+        Ranges.begin(), Ranges.end(), idx,
+        [](const Range &r, int value) { return r.second < value; });
+  }
+
+public:
+  void Clear() { Ranges.clear(); }
+  bool Empty() const { return Ranges.empty(); }
+  const std::vector<Range> &Get() const { return Ranges; }
+
+  size_t Count() const {
+    size_t total = 0;
+    for (const auto &r : Ranges)
+      total += (size_t)(r.second - r.first + 1);
+    return total;
+  }
+
+  bool Contains(int idx) const {
+    auto it = std::lower_bound(
+        Ranges.begin(), Ranges.end(), idx,
+        [](const Range &r, int value) { return r.second < value; });
+    return it != Ranges.end() && it->first <= idx;
+  }
+
+  void Add(int first, int last) {
+    if (first > last)
+      std::swap(first, last);
+    // merge with everything overlapping or directly adjacent
+    auto begin = LowerBound(first - 1);
+    auto end = begin;
+    while (end != Ranges.end() && end->first <= last + 1) {
+      first = std::min(first, end->first);
+      last = std::max(last, end->second);
+      ++end;
+    }
+    begin = Ranges.erase(begin, end);
+    Ranges.insert(begin, Range(first, last));
+  }
+
+  void Remove(int first, int last) {
+    if (first > last)
+      std::swap(first, last);
+    std::vector<Range> kept;
+    kept.reserve(Ranges.size() + 1);
+    for (const auto &r : Ranges) {
+      if (r.second < first || r.first > last) {
+        kept.push_back(r);
+        continue;
+      }
+      if (r.first < first)
+        kept.emplace_back(r.first, first - 1);
+      if (r.second > last)
+        kept.emplace_back(last + 1, r.second);
+    }
+    Ranges.swap(kept);
+  }
+
+  void Toggle(int idx) {
+    if (Contains(idx))
+      Remove(idx, idx);
+    else
+      Add(idx, idx);
+  }
+
+  // rows [0, count) went away and everything after moved up
+  void DropFront(int count) {
+    if (count <= 0)
+      return;
+    std::vector<Range> kept;
+    kept.reserve(Ranges.size());
+    for (const auto &r : Ranges) {
+      if (r.second < count)
+        continue;
+      kept.emplace_back(std::max(r.first, count) - count, r.second - count);
+    }
+    Ranges.swap(kept);
+  }
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "ScriptAPI.hpp"
 #include "TextEditor.h"
+#include "TextMatch.hpp"
 #include "imgui.h"
 #include <algorithm>
 #include <cctype>
@@ -302,18 +303,13 @@ private:
     suggestions.clear();
     auto &allFuncs = ScriptAPI::Database::GetEngineFunctions();
 
-    std::string queryLower = query;
-    std::transform(queryLower.begin(), queryLower.end(), queryLower.begin(),
-                   ::tolower);
+    std::string queryLower = TextMatch::FoldCopy(query);
 
     for (const auto &func : allFuncs) {
-      std::string nameLower = func.Name;
-      std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(),
-                     ::tolower);
-
-      size_t pos = nameLower.find(queryLower);
-      if (pos != std::string::npos) {
-        int score = (pos == 0 ? 100 : 50) - (int)nameLower.length();
+      std::string_view name(func.Name);
+      size_t pos = TextMatch::Find(name, queryLower);
+      if (pos != std::string_view::npos) {
+        int score = (pos == 0 ? 100 : 50) - (int)name.length();
         suggestions.push_back({&func, score});
       }
     }
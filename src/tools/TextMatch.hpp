@@ -0,0 +1,214 @@
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXTMATCH_SSE2 1
+// AVX2 is picked at runtime, the rest of the build stays baseline x86-64
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXTMATCH_AVX2 1
+#endif
+#endif
+
+// ASCII case-insensitive substring search shared by all the filter boxes.
+// Needles are folded to lowercase once up front; haystacks are folded on the
+// fly, 16 or 32 bytes at a time, so no call allocates. Candidate positions are
+// found by comparing the first and last needle byte across a whole vector
+// and only those get a full compare.
+namespace TextMatch {
+
+inline char Fold(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+inline std::string FoldCopy(std::string_view s) {
+  std::string out(s);
+  for (auto &c : out)
+    c = Fold(c);
+  return out;
+}
+
+namespace Detail {
+
+inline bool EqualFolded(const char *hay, const char *needle, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (Fold(hay[i]) != needle[i])
+      return false;
+  }
+  return true;
+}
+
+inline size_t FindScalar(std::string_view hay, std::string_view needle,
+                         size_t from) {
+  if (needle.size() > hay.size())
+    return std::string_view::npos;
+  size_t last = hay.size() - needle.size();
+  for (size_t i = from; i <= last; i++) {
+    if (Fold(hay[i]) == needle[0] &&
+        EqualFolded(hay.data() + i + 1, needle.data() + 1, needle.size() - 1))
+      return i;
+  }
+  return std::string_view::npos;
+}
+
+#if TEXTMATCH_SSE2
+inline __m128i Fold16(__m128i v) {
+  // bytes in 'A'..'Z' get 0x20 or'ed in; the bias turns the unsigned range
+  // check into a single signed compare
+  __m128i biased = _mm_add_epi8(v, _mm_set1_epi8((char)(128 - 'A')));
+  __m128i upper = _mm_cmplt_epi8(biased, _mm_set1_epi8((char)(-128 + 26)));
+  return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+inline size_t FindSSE2(std::string_view hay, std::string_view needle) {
+  size_t n = needle.size();
+  if (n > hay.size())
+    return std::string_view::npos;
+
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[n - 1]);
+  const char *p = hay.data();
+
+  size_t i = 0;
+  for (; i + 16 + n - 1 <= hay.size(); i += 16) {
+    __m128i a = Fold16(_mm_loadu_si128((const __m128i *)(p + i)));
+    __m128i b = Fold16(_mm_loadu_si128((const __m128i *)(p + i + n - 1)));
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+    while (mask) {
+      unsigned bit = __builtin_ctz(mask);
+      if (n <= 2 || EqualFolded(p + i + bit + 1, needle.data() + 1, n - 2))
+        return i + bit;
+      mask &= mask - 1;
+    }
+  }
+  return FindScalar(hay, needle, i);
+}
+#endif
+
+#if TEXTMATCH_AVX2
+__attribute__((target("avx2"))) inline __m256i Fold32(__m256i v) {
+  __m256i biased = _mm256_add_epi8(v, _mm256_set1_epi8((char)(128 - 'A')));
+  __m256i upper =
+      _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), biased);
+  return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2"))) inline size_t
+FindAVX2(std::string_view hay, std::string_view needle) {
+  size_t n = needle.size();
+  if (n > hay.size())
+    return std::string_view::npos;
+
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+  const char *p = hay.data();
+
+  size_t i = 0;
+  for (; i + 32 + n - 1 <= hay.size(); i += 32) {
+    __m256i a = Fold32(_mm256_loadu_si256((const __m256i *)(p + i)));
+    __m256i b = Fold32(_mm256_loadu_si256((const __m256i *)(p + i + n - 1)));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+    while (mask) {
+      unsigned bit = __builtin_ctz(mask);
+      if (n <= 2 || EqualFolded(p + i + bit + 1, needle.data() + 1, n - 2))
+        return i + bit;
+      mask &= mask - 1;
+    }
+  }
+  // finish the remainder with the narrower loop
+  size_t rest = FindSSE2(hay.substr(i), needle);
+  return rest == std::string_view::npos ? rest : i + rest;
+}
+
+inline bool HasAVX2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+} // namespace Detail
+
+// Position of needleFolded (already lowercase) in hay, ignoring ASCII case.
+inline size_t Find(std::string_view hay, std::string_view needleFolded) {
+  if (needleFolded.empty())
+    return 0;
+#if TEXTMATCH_AVX2
+  if (hay.size() >= 64 && Detail::HasAVX2())
+    return Detail::FindAVX2(hay, needleFolded);
+#endif
+#if TEXTMATCH_SSE2
+  return Detail::FindSSE2(hay, needleFolded);
+#else
+  return Detail::FindScalar(hay, needleFolded, 0);
+#endif
+}
+
+inline bool Contains(std::string_view hay, std::string_view needleFolded) {
+  return Find(hay, needleFolded) != std::string_view::npos;
+}
+
+// Same syntax as ImGuiTextFilter: comma separated terms, surrounding spaces
+// ignored, '-' prefix excludes. Passes when no exclude matches and, if there
+// are any includes, at least one include matches.
+class Filter {
+  std::vector<std::string> Includes;
+  std::vector<std::string> Excludes;
+
+public:
+  Filter() = default;
+  explicit Filter(std::string_view text) { Build(text); }
+
+  void Build(std::string_view text) {
+    Includes.clear();
+    Excludes.clear();
+    while (!text.empty()) {
+      size_t comma = text.find(',');
+      std::string_view term = text.substr(0, comma);
+      text = (comma == std::string_view::npos) ? std::string_view()
+                                               : text.substr(comma + 1);
+
+      while (!term.empty() && std::isspace((unsigned char)term.front()))
+        term.remove_prefix(1);
+      while (!term.empty() && std::isspace((unsigned char)term.back()))
+        term.remove_suffix(1);
+      if (term.empty())
+        continue;
+
+      if (term[0] == '-') {
+        if (term.size() > 1)
+          Excludes.push_back(FoldCopy(term.substr(1)));
+      } else {
+        Includes.push_back(FoldCopy(term));
+      }
+    }
+  }
+
+  bool IsActive() const { return !Includes.empty() || !Excludes.empty(); }
+
+  const std::vector<std::string> &IncludeTerms() const { return Includes; }
+  const std::vector<std::string> &ExcludeTerms() const { return Excludes; }
+
+  bool Pass(std::string_view text) const {
+    for (const auto &ex : Excludes) {
+      if (Contains(text, ex))
+        return false;
+    }
+    if (Includes.empty())
+      return true;
+    for (const auto &in : Includes) {
+      if (Contains(text, in))
+        return true;
+    }
+    return false;
+  }
+};
+
+} // namespace TextMatch
@@ -0,0 +1,221 @@
+#pragma once
+#include "../tools/ConsoleBatch.hpp"
+#include "../tools/LogChannelCursor.hpp"
+#include "ConsoleWindow.hpp"
+#include "LogWindow.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class ConsoleBatchWindow {
+  LogWindow *Source = nullptr;
+  ConsoleBatch Batch;
+  LogChannelCursor Cursor;
+
+  char PathBuf[512] = "";
+  std::vector<char> Script = std::vector<char>(64 * 1024, '\0');
+  std::string Status;
+  int Expanded = -1;
+
+  void LoadFile() {
+    std::ifstream file(PathBuf, std::ios::binary);
+    if (!file) {
+      Status = std::string("Cannot open ") + PathBuf;
+      return;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string text = ss.str();
+    if (text.size() >= Script.size())
+      Script.resize(text.size() + 64 * 1024, '\0');
+    memcpy(Script.data(), text.c_str(), text.size() + 1);
+    Status.clear();
+  }
+
+  void Run() {
+    size_t count = Batch.Load(Script.data());
+    if (count == 0) {
+      Status = "Nothing to run";
+      return;
+    }
+    Expanded = -1;
+    // only output that arrives from now on can belong to the batch
+    Cursor.Reset(Source->GetStore());
+    Batch.Start(LogWindow::NowMs());
+    Status.clear();
+  }
+
+  // console output since the last frame goes to the command that caused it
+  void Pump() {
+    const LogStore &store = Source->GetStore();
+    int64_t now = LogWindow::NowMs();
+    Cursor.Poll(store, ConsoleWindow::ChannelName, [&](size_t idx) {
+      std::string_view msg = store.Message(store[idx]);
+      // command echoes, see ConsoleWindow::EchoCommand
+      if (msg.size() >= 2 && msg[0] == '#' && msg[1] == ' ')
+        return;
+      int64_t t = store.Time(idx);
+      Batch.OnOutput(idx, t != 0 ? t : now);
+    });
+    Batch.Update(now);
+  }
+
+  void DrawSettings() {
+    ImGui::SetNextItemWidth(120);
+    if (ImGui::InputInt("Interval (ms)", &Batch.IntervalMs, 10, 100))
+      Batch.IntervalMs = std::max(Batch.IntervalMs, 0);
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Minimum time between two sends, 0 sends "
+                        "everything at once");
+    ImGui::SameLine();
+    ImGui::Checkbox("Wait for output", &Batch.WaitForOutput);
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Send the next command only once the previous one "
+                        "stopped printing.\nSlower, but output can't be "
+                        "attributed to the wrong command.");
+    ImGui::SetNextItemWidth(120);
+    if (ImGui::InputInt("Quiet (ms)", &Batch.QuietMs, 10, 100))
+      Batch.QuietMs = std::max(Batch.QuietMs, 1);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120);
+    if (ImGui::InputInt("Timeout (ms)", &Batch.TimeoutMs, 100, 1000))
+      Batch.TimeoutMs = std::max(Batch.TimeoutMs, Batch.QuietMs);
+  }
+
+  void DrawSummary() {
+    BatchSummary s = Batch.Summarize();
+    ImGui::Text("%zu/%zu sent, %zu answered, %zu output lines, %.2f s "
+                "(%.1f cmd/s)",
+                s.sent, Batch.List().size(), s.answered, s.outputLines,
+                s.totalMs / 1000.0, s.commandsPerSec);
+    if (s.answered > 0)
+      ImGui::Text("Latency: avg %.1f ms, p50 %lld ms, p95 %lld ms, "
+                  "max %lld ms",
+                  s.latencyAvgMs, (long long)s.latencyP50Ms,
+                  (long long)s.latencyP95Ms, (long long)s.latencyMaxMs);
+  }
+
+  void DrawResults() {
+    const LogStore &store = Source->GetStore();
+    const auto &list = Batch.List();
+    if (!ImGui::BeginTable("BatchResults", 4,
+                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                               ImGuiTableFlags_Resizable |
+                               ImGuiTableFlags_ScrollY))
+      return;
+    ImGui::TableSetupColumn("Line", ImGuiTableColumnFlags_WidthFixed, 40.0f);
+    ImGui::TableSetupColumn("Command", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Latency", ImGuiTableColumnFlags_WidthFixed,
+                            70.0f);
+    ImGui::TableSetupColumn("Output", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+    ImGui::TableHeadersRow();
+
+    for (int i = 0; i < (int)list.size(); i++) {
+      const BatchCommand &cmd = list[i];
+      ImGui::PushID(i);
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("%d", cmd.sourceLine);
+      ImGui::TableSetColumnIndex(1);
+      if (ImGui::Selectable(cmd.text.c_str(), Expanded == i,
+                            ImGuiSelectableFlags_SpanAllColumns))
+        Expanded = Expanded == i ? -1 : i;
+      ImGui::TableSetColumnIndex(2);
+      if (cmd.sentMs < 0)
+        ImGui::TextDisabled("-");
+      else if (cmd.firstOutputMs < 0)
+        ImGui::TextDisabled("none");
+      else
+        ImGui::Text("%lld ms", (long long)(cmd.firstOutputMs - cmd.sentMs));
+      ImGui::TableSetColumnIndex(3);
+      ImGui::Text("%zu", cmd.output.size());
+
+      if (Expanded == i) {
+        for (size_t idx : cmd.output) {
+          ImGui::TableNextRow();
+          ImGui::TableSetColumnIndex(1);
+          if (!store.Contains(idx)) {
+            ImGui::TextDisabled("(dropped from the game log)");
+            continue;
+          }
+          const LogRecord &rec = store[idx];
+          std::string_view msg = store.Message(rec);
+          ImGui::PushStyleColor(ImGuiCol_Text, rec.color);
+          ImGui::TextUnformatted(msg.data(), msg.data() + msg.size());
+          ImGui::PopStyleColor();
+        }
+      }
+      ImGui::PopID();
+    }
+    ImGui::EndTable();
+  }
+
+public:
+  ConsoleBatchWindow() {
+    const char *example = "# one console command per line\n";
+    memcpy(Script.data(), example, strlen(example) + 1);
+  }
+
+  void Setup(LogWindow *source,
+             std::function<void(const std::string &)> sendCommand) {
+    Source = source;
+    Batch.Send = sendCommand;
+  }
+
+  void Draw(const char *title, bool *p_open = nullptr) {
+    if (Source && Batch.IsRunning())
+      Pump();
+
+    ImGui::SetNextWindowSize(ImVec2(600, 500), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(title, p_open)) {
+      ImGui::End();
+      return;
+    }
+    if (!Source) {
+      ImGui::End();
+      return;
+    }
+
+    ImGui::SetNextItemWidth(-70.0f);
+    bool load = ImGui::InputTextWithHint("##path", "Script file", PathBuf,
+                                         sizeof(PathBuf),
+                                         ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    load |= ImGui::Button("Load");
+    if (load && PathBuf[0] != '\0')
+      LoadFile();
+
+    ImGui::InputTextMultiline("##script", Script.data(), Script.size(),
+                              ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 8),
+                              ImGuiInputTextFlags_AllowTabInput);
+    DrawSettings();
+
+    if (Batch.IsRunning()) {
+      if (ImGui::Button("Stop"))
+        Batch.Stop();
+      ImGui::SameLine();
+      float progress = Batch.List().empty()
+                           ? 1.0f
+                           : (float)Batch.SentCount() / Batch.List().size();
+      ImGui::ProgressBar(progress, ImVec2(150, 0));
+    } else if (ImGui::Button("Run")) {
+      Run();
+    }
+    if (!Status.empty()) {
+      ImGui::SameLine();
+      ImGui::TextDisabled("%s", Status.c_str());
+    }
+
+    if (Batch.HasResults()) {
+      ImGui::Separator();
+      DrawSummary();
+      DrawResults();
+    }
+    ImGui::End();
+  }
+};
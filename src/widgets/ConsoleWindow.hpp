@@ -1,10 +1,19 @@
 #pragma once
+#include "../tools/GlobalsManager.hpp"
+#include "../tools/LogChannelCursor.hpp"
+#include "../tools/PrefixIndex.hpp"
+#include "../tools/ScriptAPI.hpp"
+#include "LogWindow.hpp"
 #include "imgui.h"
 #include <algorithm>
+#include <cctype>
 #include <cstdint>
+#include <cstdio>
+#include <deque>
 #include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 struct CommandDefinition {
@@ -13,36 +22,67 @@ struct CommandDefinition {
   std::string usage;
 };
 
-struct ConsoleLogEntry {
-  std::string msg;
-  int32_t colorCode;
-  bool isCommand;
-};
-
 class ConsoleWindow {
   char InputBuf[256];
   std::vector<std::string> History;
   int HistoryPos = -1;
 
-  std::vector<ConsoleLogEntry> Items;
-  std::set<int> SelectedIndices;
+  // The console is a view over the game log's store: Rows holds the store
+  // indices of "Console" channel lines, nothing is copied.
+  LogWindow *Source = nullptr;
+  std::deque<size_t> Rows;
+  LogChannelCursor Cursor;
+  size_t SelectedRow = SIZE_MAX;
+  int MaxRows = 20000;
   bool AutoScroll = true;
   bool ScrollToBottom = false;
 
   std::vector<CommandDefinition> Commands;
-  std::vector<int> Candidates;
+
+  // Completion: Names completes the word under the cursor (console
+  // commands, engine script functions and the project's own globals),
+  // HistoryIndex the whole line.
+  enum CompletionKind { KindCommand, KindGlobal, KindHistory, KindProject };
+  static constexpr int MaxHistoryCandidates = 4;
+  PrefixIndex Names;
+  PrefixIndex HistoryIndex;
+  uint64_t HistorySeq = 0;
+
+  const GlobalsManager *Globals = nullptr;
+  size_t KnownGlobalsRevision = SIZE_MAX;
+  std::vector<std::string> ProjectGlobalFiles; // KindProject payloads
+
+  struct Candidate {
+    uint32_t id;
+    bool history;
+  };
+  std::vector<Candidate> Candidates;
   int CandidatePos = 0;
-  bool IsPopupOpen = false;
+  int CandidatesCursor = -1; // cursor position the candidates are for
+  int WordStart = 0;
+  // Tab opens the list when it can't decide; while open the arrows pick
+  // from it, otherwise they browse history as usual
+  bool PopupOpen = false;
 
   std::function<void(std::string)> SendCommandCallback;
 
-  ImVec4 GetColorForCode(int32_t col) const {
-    if (col == 0)
-      return ImVec4(0.9f, 0.9f, 0.9f, 1.0f);
-    int r = (col >> 16) & 0xFF;
-    int g = (col >> 8) & 0xFF;
-    int b = col & 0xFF;
-    return ImVec4(r / 255.0f, g / 255.0f, b / 255.0f, 1.0f);
+  // picks up console lines added to the store since the last frame and
+  // forgets the ones the store or our own limit dropped
+  void SyncRows() {
+    const LogStore &store = Source->GetStore();
+    size_t before = Rows.size();
+    if (!Cursor.Poll(store, ChannelName,
+                     [this](size_t idx) { Rows.push_back(idx); })) {
+      // the game log was cleared, keep only what came after that
+      Rows.erase(Rows.begin(), Rows.begin() + before);
+      SelectedRow = SIZE_MAX;
+    }
+    if (AutoScroll && Rows.size() != before)
+      ScrollToBottom = true;
+
+    while (!Rows.empty() &&
+           (Rows.front() < store.Begin() || Rows.size() > (size_t)MaxRows))
+      Rows.pop_front();
   }
 
   static int TextEditCallbackStub(ImGuiInputTextCallbackData *data) {
@@ -53,39 +93,39 @@ class ConsoleWindow {
   int TextEditCallback(ImGuiInputTextCallbackData *data) {
 
     if (data->EventFlag == ImGuiInputTextFlags_CallbackCompletion) {
-      const char *word_end = data->Buf + data->CursorPos;
-      const char *word_start = word_end;
-      while (word_start > data->Buf) {
-        const char c = word_start[-1];
-        if (c == ' ' || c == '\t' || c == ',' || c == ';')
-          break;
-        word_start--;
-      }
-
-      std::string fragment = std::string(word_start, word_end - word_start);
-      std::string fragmentLower = fragment;
-      std::transform(fragmentLower.begin(), fragmentLower.end(),
-                     fragmentLower.begin(), ::tolower);
-
-      Candidates.clear();
-      for (int i = 0; i < Commands.size(); i++) {
-        std::string cmdLower = Commands[i].name;
-        std::transform(cmdLower.begin(), cmdLower.end(), cmdLower.begin(),
-                       ::tolower);
-        if (cmdLower.find(fragmentLower) == 0)
-          Candidates.push_back(i);
+      if (data->CursorPos != CandidatesCursor)
+        UpdateCandidates(data->Buf, data->CursorPos);
+      if (Candidates.empty())
+        return 0;
+
+      if (PopupOpen || Candidates.size() == 1) {
+        AcceptCandidate(data, Candidates[CandidatePos]);
+        return 0;
       }
-
-      if (Candidates.empty()) {
-      } else if (Candidates.size() == 1) {
-        ReplaceWord(data, word_start - data->Buf, word_end - data->Buf,
-                    Commands[Candidates[0]].name);
-        Candidates.clear();
-      } else {
+      // first Tab only extends as far as all candidates agree, and shows
+      // them when that's not the whole way
+      std::string word(data->Buf + WordStart, data->CursorPos - WordStart);
+      if (!word.empty()) {
+        std::string extended = Names.Extend(word);
+        if (extended.size() > word.size()) {
+          data->DeleteChars(WordStart, data->CursorPos - WordStart);
+          data->InsertChars(WordStart, extended.c_str());
+          UpdateCandidates(data->Buf, data->CursorPos);
+        }
       }
+      PopupOpen = Candidates.size() > 1;
     }
 
     else if (data->EventFlag == ImGuiInputTextFlags_CallbackHistory) {
+      if (PopupOpen && !Candidates.empty()) {
+        int count = (int)Candidates.size();
+        if (data->EventKey == ImGuiKey_UpArrow)
+          CandidatePos = (CandidatePos + count - 1) % count;
+        else if (data->EventKey == ImGuiKey_DownArrow)
+          CandidatePos = (CandidatePos + 1) % count;
+        return 0;
+      }
+
       const int prev_history_pos = HistoryPos;
       if (data->EventKey == ImGuiKey_UpArrow) {
         if (HistoryPos == -1)
@@ -104,12 +144,56 @@ class ConsoleWindow {
         data->DeleteChars(0, data->BufTextLen);
         data->InsertChars(0, history_str);
       }
-    } else if (data->EventFlag == ImGuiInputTextFlags_CallbackAlways) {
+    } else if (data->EventFlag == ImGuiInputTextFlags_CallbackEdit) {
+      HistoryPos = -1;
+      UpdateCandidates(data->Buf, data->CursorPos);
+      if (Candidates.empty())
+        PopupOpen = false;
     }
 
     return 0;
   }
 
+  // history lines matching the input so far, then names matching the word
+  // under the cursor
+  void UpdateCandidates(const char *buf, int cursorPos) {
+    Candidates.clear();
+    CandidatePos = 0;
+    CandidatesCursor = cursorPos;
+    std::string_view line(buf, cursorPos);
+    size_t sep = line.find_last_of(" \t,;");
+    WordStart = sep == std::string_view::npos ? 0 : (int)sep + 1;
+    if (line.empty())
+      return;
+
+    int shown = 0;
+    for (uint32_t id : HistoryIndex.Query(line)) {
+      if (shown == MaxHistoryCandidates)
+        break;
+      if (HistoryIndex.Entry(id).text.size() == line.size())
+        continue; // already typed out
+      Candidates.push_back({id, true});
+      shown++;
+    }
+    std::string_view word = line.substr(WordStart);
+    if (!word.empty()) {
+      for (uint32_t id : Names.Query(word))
+        Candidates.push_back({id, false});
+    }
+  }
+
+  void AcceptCandidate(ImGuiInputTextCallbackData *data, Candidate c) {
+    if (c.history) {
+      data->DeleteChars(0, data->BufTextLen);
+      data->InsertChars(0, HistoryIndex.Entry(c.id).text.c_str());
+    } else {
+      ReplaceWord(data, WordStart, data->CursorPos, Names.Entry(c.id).text);
+    }
+    Candidates.clear();
+    CandidatesCursor = -1;
+    PopupOpen = false;
+  }
+
   void ReplaceWord(ImGuiInputTextCallbackData *data, int start_pos, int end_pos,
                    const std::string &replacement) {
     data->DeleteChars(start_pos, end_pos - start_pos);
@@ -118,11 +202,13 @@ class ConsoleWindow {
   }
 
   void ExecCommand(const std::string &cmd_line) {
-    AddLog("# " + cmd_line, 0x00AAAAAA, true);
+    EchoCommand(cmd_line);
     HistoryPos = -1;
     if (History.empty() || History.back() != cmd_line) {
       History.push_back(cmd_line);
     }
+    HistoryIndex.Add(cmd_line, KindHistory, 0, ++HistorySeq);
+    BumpUsedNames(cmd_line);
     if (SendCommandCallback)
       SendCommandCallback(cmd_line);
     ScrollToBottom = true;
@@ -199,29 +285,177 @@ class ConsoleWindow {
               });
   }
 
+  static bool IsNameChar(char c) {
+    return std::isalnum((unsigned char)c) || c == '_';
+  }
+
+  // Names used in a line float up in the completion list, matched the way
+  // completion matches them, ignoring case: the command (the longest one,
+  // some have spaces in them) and any other name used as an argument.
+  void BumpUsedNames(const std::string &line) {
+    std::vector<uint32_t> used;
+    for (size_t end = line.size(); end > 0;) {
+      int64_t id = Names.FindFolded(std::string_view(line).substr(0, end));
+      if (id >= 0) {
+        used.push_back((uint32_t)id);
+        break;
+      }
+      size_t sep = line.find_last_of(" \t", end - 1);
+      end = sep == std::string::npos ? 0 : sep;
+    }
+    for (size_t i = 0; i < line.size();) {
+      if (!IsNameChar(line[i])) {
+        i++;
+        continue;
+      }
+      size_t start = i;
+      while (i < line.size() && IsNameChar(line[i]))
+        i++;
+      int64_t id =
+          Names.FindFolded(std::string_view(line).substr(start, i - start));
+      if (id >= 0)
+        used.push_back((uint32_t)id);
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    for (uint32_t id : used)
+      Names.Touch(id, Names.Entry(id).rank + 4);
+  }
+
+  // commands rank above script functions until usage says otherwise;
+  // rebuilt when the project's globals change, keeping the usage ranks
+  void BuildNameIndex() {
+    std::unordered_map<std::string, uint64_t> ranks;
+    for (uint32_t id = 0; id < Names.Size(); id++)
+      ranks[Names.Entry(id).text] = Names.Entry(id).rank;
+    Names.Clear();
+    Candidates.clear();
+    CandidatesCursor = -1;
+    PopupOpen = false;
+
+    for (int i = 0; i < (int)Commands.size(); i++)
+      Names.Add(Commands[i].name, KindCommand, i, 2);
+    const auto &funcs = ScriptAPI::Database::GetEngineFunctions();
+    for (int i = 0; i < (int)funcs.size(); i++) {
+      // a few names carry their C return type, e.g. "float\tName"
+      std::string_view name = funcs[i].Name;
+      size_t space = name.find_last_of(" \t");
+      if (space != std::string_view::npos)
+        name.remove_prefix(space + 1);
+      if (!name.empty())
+        Names.Add(std::string(name), KindGlobal, i, 1);
+    }
+    ProjectGlobalFiles.clear();
+    if (Globals) {
+      for (const auto &[name, loc] : Globals->Globals()) {
+        Names.Add(name, KindProject, (int)ProjectGlobalFiles.size(), 1);
+        ProjectGlobalFiles.push_back(loc.FilePath);
+      }
+    }
+    for (const auto &[text, rank] : ranks) {
+      int64_t id = Names.Find(text);
+      if (id >= 0)
+        Names.Touch((uint32_t)id, rank);
+    }
+  }
+
+  void DrawCandidate(const Candidate &c, bool selected) {
+    ImVec4 dim(0.5f, 0.5f, 0.5f, 1.0f);
+    if (selected) {
+      ImVec2 min = ImGui::GetCursorScreenPos();
+      ImVec2 max(min.x + ImGui::GetContentRegionAvail().x,
+                 min.y + ImGui::GetTextLineHeight());
+      ImGui::GetWindowDrawList()->AddRectFilled(
+          min, max, ImGui::GetColorU32(ImGuiCol_Header));
+    }
+    if (c.history) {
+      ImGui::TextUnformatted(HistoryIndex.Entry(c.id).text.c_str());
+      ImGui::SameLine();
+      ImGui::TextColored(dim, "history");
+      return;
+    }
+
+    const PrefixEntry &e = Names.Entry(c.id);
+    if (e.kind == KindCommand) {
+      const auto &cmd = Commands[e.payload];
+      ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.4f, 1.0f), "%s",
+                         cmd.name.c_str());
+      if (!cmd.usage.empty()) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%s",
+                           cmd.usage.c_str());
+      }
+      ImGui::TextColored(dim, "  %s", cmd.description.c_str());
+      return;
+    }
+
+    if (e.kind == KindProject) {
+      ImGui::TextColored(ImVec4(0.6f, 1.0f, 0.6f, 1.0f), "%s", e.text.c_str());
+      ImGui::SameLine();
+      ImGui::TextColored(dim, "project, %s",
+                         ProjectGlobalFiles[e.payload].c_str());
+      return;
+    }
+
+    const auto &func = ScriptAPI::Database::GetEngineFunctions()[e.payload];
+    ImGui::TextColored(ImVec4(0.5f, 0.8f, 1.0f, 1.0f), "%s", e.text.c_str());
+    ImGui::SameLine();
+    ImGui::TextColored(dim, "script, returns %s", func.ReturnType);
+    // descriptions are long, only show the one being picked
+    if (selected) {
+      ImGui::PushStyleColor(ImGuiCol_Text, dim);
+      ImGui::TextWrapped("  %s", func.Desc);
+      ImGui::PopStyleColor();
+    }
+  }
+
 public:
+  static constexpr const char *ChannelName = "Console";
+
   ConsoleWindow() {
     memset(InputBuf, 0, sizeof(InputBuf));
     InitCommands();
+    BuildNameIndex();
   }
 
   void SetSendCommandCallback(std::function<void(std::string)> cb) {
     SendCommandCallback = cb;
   }
 
-  void ClearLog() {
-    Items.clear();
-    SelectedIndices.clear();
+  // offers the project's globals for completion, kept current as they
+  // change
+  void SetGlobals(const GlobalsManager *globals) {
+    Globals = globals;
+    KnownGlobalsRevision = SIZE_MAX;
   }
 
-  void AddLog(const std::string &msg, int32_t colorCode, bool isCmd = false) {
-    Items.push_back({msg, colorCode, isCmd});
-    if (AutoScroll)
-      ScrollToBottom = true;
+  // shows the "Console" channel of this log window
+  void SetSource(LogWindow *source) {
+    Source = source;
+    Rows.clear();
+    Cursor = LogChannelCursor();
+  }
+
+  // shows a sent command in the console as "# cmd"
+  void EchoCommand(const std::string &cmd) {
+    if (Source)
+      Source->AddLog("# " + cmd, ChannelName, 0x00B3B3B3);
+  }
+
+  // only hides what is shown so far, the game log keeps the lines
+  void ClearLog() {
+    Rows.clear();
+    SelectedRow = SIZE_MAX;
   }
 
   void Draw(const char *title, bool *p_open = nullptr) {
     ImGui::SetNextWindowSize(ImVec2(520, 600), ImGuiCond_FirstUseEver);
+    if (Source)
+      SyncRows();
+    if (Globals && Globals->GetRevision() != KnownGlobalsRevision) {
+      KnownGlobalsRevision = Globals->GetRevision();
+      BuildNameIndex();
+    }
     if (!ImGui::Begin(title, p_open)) {
       ImGui::End();
       return;
@@ -238,36 +472,57 @@ public:
       if (ImGui::BeginPopupContextWindow()) {
         if (ImGui::Selectable("Clear"))
           ClearLog();
+        ImGui::SetNextItemWidth(120);
+        if (ImGui::InputInt("Max lines", &MaxRows, 1000, 10000))
+          MaxRows = std::clamp(MaxRows, 100, 1000000);
         ImGui::EndPopup();
       }
 
       ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(4, 1));
 
       ImGuiListClipper clipper;
-      clipper.Begin(Items.size());
+      clipper.Begin(Source ? (int)Rows.size() : 0);
       while (clipper.Step()) {
+        const LogStore &store = Source->GetStore();
         for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
-          const auto &item = Items[i];
-          ImVec4 col = GetColorForCode(item.colorCode);
-          if (item.isCommand)
-            col = ImVec4(0.7f, 0.7f, 0.7f, 1.0f);
+          size_t idx = Rows[i];
+          const LogRecord &rec = store[idx];
 
-          ImGui::PushStyleColor(ImGuiCol_Text, col);
           ImGui::PushID(i);
 
-          bool is_selected = SelectedIndices.count(i);
-          const char *label = item.msg.empty() ? "##" : item.msg.c_str();
+          bool is_selected = SelectedRow == idx;
+          const char *msg = store.MessageCStr(rec);
+          const char *fullEnd = msg + rec.length;
+          const char *msgEnd;
+          int moreLines = LogWindow::FirstLine(msg, fullEnd, msgEnd);
 
-          if (ImGui::Selectable(label, is_selected,
+          // the message is drawn as text, not as the label, so "##" in it
+          // stays visible and a traceback keeps to its row
+          ImVec2 rowPos = ImGui::GetCursorScreenPos();
+          if (ImGui::Selectable("##row", is_selected,
                                 ImGuiSelectableFlags_SpanAllColumns)) {
-            SelectedIndices.clear();
-            SelectedIndices.insert(i);
-            if (!item.msg.empty())
-              ImGui::SetClipboardText(item.msg.c_str());
+            SelectedRow = idx;
+            if (rec.length != 0)
+              ImGui::SetClipboardText(msg);
+          }
+          bool hovered = ImGui::IsItemHovered();
+          ImDrawList *drawList = ImGui::GetWindowDrawList();
+          drawList->AddText(rowPos, rec.color, msg, msgEnd);
+          if (moreLines > 0) {
+            char moreText[32];
+            snprintf(moreText, sizeof(moreText), "  (+%d lines)", moreLines);
+            drawList->AddText(
+                ImVec2(rowPos.x + ImGui::CalcTextSize(msg, msgEnd).x,
+                       rowPos.y),
+                ImGui::GetColorU32(ImGuiCol_TextDisabled), moreText);
+            if (hovered) {
+              ImGui::BeginTooltip();
+              ImGui::TextUnformatted(msg, fullEnd);
+              ImGui::EndTooltip();
+            }
           }
 
           ImGui::PopID();
-          ImGui::PopStyleColor();
         }
       }
       clipper.End();
@@ -286,7 +541,8 @@ public:
     bool reclaim_focus = false;
     ImGuiInputTextFlags input_flags = ImGuiInputTextFlags_EnterReturnsTrue |
                                       ImGuiInputTextFlags_CallbackHistory |
-                                      ImGuiInputTextFlags_CallbackCompletion;
+                                      ImGuiInputTextFlags_CallbackCompletion |
+                                      ImGuiInputTextFlags_CallbackEdit;
 
     ImGui::PushItemWidth(-1);
 
@@ -307,46 +563,21 @@ public:
       strcpy(InputBuf, "");
       reclaim_focus = true;
       Candidates.clear();
+      CandidatesCursor = -1;
+      PopupOpen = false;
     }
     ImGui::PopItemWidth();
+    bool input_active = ImGui::IsItemActive();
 
-    if (ImGui::IsItemActive() || ImGui::IsItemFocused()) {
-      std::string inputStr = InputBuf;
-      if (!inputStr.empty()) {
-        size_t lastSpace = inputStr.find_last_of(" ");
-        std::string currentWord = (lastSpace == std::string::npos)
-                                      ? inputStr
-                                      : inputStr.substr(lastSpace + 1);
-
-        if (!currentWord.empty()) {
-          Candidates.clear();
-          std::string currentWordLower = currentWord;
-          std::transform(currentWordLower.begin(), currentWordLower.end(),
-                         currentWordLower.begin(), ::tolower);
-
-          for (int i = 0; i < Commands.size(); i++) {
-            std::string cmdLower = Commands[i].name;
-            std::transform(cmdLower.begin(), cmdLower.end(), cmdLower.begin(),
-                           ::tolower);
-            if (cmdLower.find(currentWordLower) == 0) {
-              Candidates.push_back(i);
-            }
-          }
-        } else {
-          Candidates.clear();
-        }
-      } else {
-        Candidates.clear();
-      }
-    }
-
-    if (!Candidates.empty()) {
+    if (!input_active)
+      PopupOpen = false;
+    if (PopupOpen && !Candidates.empty()) {
       ImVec2 inputMin = ImGui::GetItemRectMin();
       ImVec2 inputSize = ImGui::GetItemRectSize();
       ImGui::SetNextWindowPos(ImVec2(inputMin.x, inputMin.y - 2.0f),
                               ImGuiCond_Always, ImVec2(0.0f, 1.0f));
       ImGui::SetNextWindowSizeConstraints(ImVec2(inputSize.x, 0),
-                                          ImVec2(inputSize.x, 200));
+                                          ImVec2(inputSize.x, 300));
 
       ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
       if (ImGui::Begin("##Candidates", nullptr,
@@ -355,18 +586,9 @@ public:
                            ImGuiWindowFlags_NoFocusOnAppearing |
                            ImGuiWindowFlags_AlwaysAutoResize |
                            ImGuiWindowFlags_Tooltip)) {
-        for (int idx : Candidates) {
-          const auto &cmd = Commands[idx];
-          ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.4f, 1.0f), "%s",
-                             cmd.name.c_str());
-          if (!cmd.usage.empty()) {
-            ImGui::SameLine();
-            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%s",
-                               cmd.usage.c_str());
-          }
-          ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "  %s",
-                             cmd.description.c_str());
-          if (idx != Candidates.back())
+        for (int i = 0; i < (int)Candidates.size(); i++) {
+          DrawCandidate(Candidates[i], i == CandidatePos);
+          if (i + 1 < (int)Candidates.size())
             ImGui::Separator();
         }
         ImGui::End();
@@ -21,6 +21,7 @@ public:
   DebuggerPanel() : CurrentContext() {}
 
   void SetState(DebuggerState state) { currentState = state; }
+  DebuggerState GetState() const { return currentState; }
 
   void UpdateContext(const EventGotScriptContext &ctx) {
     CurrentContext = ctx;
@@ -0,0 +1,320 @@
+#pragma once
+#include "../tools/LocalTime.hpp"
+#include "../tools/LogArchive.hpp"
+#include "../tools/TextMatch.hpp"
+#include "ImGuiFileDialog.h"
+#include "LogWindow.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Browses a binary log archive (.sal) through a memory mapping. Without a
+// filter rows are read straight from the archive; a filter runs on a
+// background thread and only the matching record numbers are kept in RAM.
+class LogArchiveWindow {
+  struct FilterPass {
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> scanned{0};
+    std::mutex mutex;
+    std::vector<uint64_t> found; // handed over to the UI in Collect()
+  };
+
+  LogArchiveReader Archive;
+  std::string OpenPath;
+  char PathBuf[512] = "";
+
+  ImGuiTextFilter Filter;
+  int SelectedChannel = -1;
+  bool Filtered = false;
+  std::vector<uint64_t> Rows; // record numbers when Filtered
+  std::shared_ptr<FilterPass> Pass;
+  std::thread PassThread;
+
+  char JumpBuf[32] = "";
+  int64_t JumpRow = -1;
+  bool ScrollToJump = false;
+
+  void CancelPass() {
+    if (Pass)
+      Pass->cancelled = true;
+    if (PassThread.joinable())
+      PassThread.join();
+    Pass.reset();
+  }
+
+  static void RunPass(std::shared_ptr<FilterPass> pass,
+                      const LogArchiveReader *archive, TextMatch::Filter terms,
+                      std::vector<uint8_t> channelPasses, int channel) {
+    constexpr uint64_t Batch = 65536;
+    std::vector<uint64_t> local;
+    uint64_t count = archive->Size();
+    for (uint64_t i = 0; i < count; i++) {
+      if ((i & 4095) == 0 && pass->cancelled)
+        return;
+      LogArchiveRecord rec = archive->Record(i);
+      if (channel >= 0 && rec.channel != channel)
+        continue;
+      bool matched = !terms.IsActive() ||
+                     (rec.channel < channelPasses.size() &&
+                      channelPasses[rec.channel]) ||
+                     terms.Pass(archive->Message(rec));
+      if (matched)
+        local.push_back(i);
+      if ((i + 1) % Batch == 0) {
+        std::lock_guard<std::mutex> lock(pass->mutex);
+        pass->found.insert(pass->found.end(), local.begin(), local.end());
+        local.clear();
+        pass->scanned = i + 1;
+      }
+    }
+    std::lock_guard<std::mutex> lock(pass->mutex);
+    pass->found.insert(pass->found.end(), local.begin(), local.end());
+    pass->scanned = count;
+    pass->done = true;
+  }
+
+  void StartFilter() {
+    CancelPass();
+    Rows.clear();
+    JumpRow = -1;
+    TextMatch::Filter terms(Filter.InputBuf);
+    Filtered = terms.IsActive() || SelectedChannel >= 0;
+    if (!Filtered || !Archive.IsOpen())
+      return;
+
+    // channels passing by name, same rule as the live log window
+    std::vector<uint8_t> channelPasses(Archive.ChannelCount(), 0);
+    if (terms.IsActive()) {
+      for (size_t i = 0; i < channelPasses.size(); i++)
+        channelPasses[i] = terms.Pass(Archive.ChannelName((uint16_t)i));
+    }
+    Pass = std::make_shared<FilterPass>();
+    PassThread = std::thread(RunPass, Pass, &Archive, std::move(terms),
+                             std::move(channelPasses), SelectedChannel);
+  }
+
+  void Collect() {
+    if (!Pass)
+      return;
+    std::lock_guard<std::mutex> lock(Pass->mutex);
+    Rows.insert(Rows.end(), Pass->found.begin(), Pass->found.end());
+    Pass->found.clear();
+  }
+
+  void OpenArchive(const std::string &path) {
+    CancelPass();
+    Rows.clear();
+    Filtered = false;
+    SelectedChannel = -1;
+    JumpRow = -1;
+    OpenPath = path;
+    snprintf(PathBuf, sizeof(PathBuf), "%s", path.c_str());
+    if (Archive.Open(path))
+      StartFilter();
+  }
+
+  // "HH:MM[:SS]" on the day of the first record, or the day after when that
+  // time of day comes before the first record (overnight sessions)
+  bool ParseJumpTime(int64_t &outMs) const {
+    int h = 0, m = 0, s = 0;
+    if (sscanf(JumpBuf, "%d:%d:%d", &h, &m, &s) < 2)
+      return false;
+    int64_t first = Archive.FirstTime();
+    time_t secs = (time_t)(first / 1000);
+    std::tm day;
+    if (!LocalTime(secs, day))
+      return false;
+    day.tm_hour = h;
+    day.tm_min = m;
+    day.tm_sec = s;
+    day.tm_isdst = -1;
+    int64_t ms = (int64_t)mktime(&day) * 1000;
+    if (ms < first - 999)
+      ms += 24ll * 3600 * 1000;
+    outMs = ms;
+    return true;
+  }
+
+  void JumpTo(int64_t timeMs) {
+    uint64_t idx = Archive.FindTime(timeMs);
+    if (Filtered) {
+      auto it = std::lower_bound(Rows.begin(), Rows.end(), idx);
+      if (it == Rows.end())
+        return;
+      JumpRow = it - Rows.begin();
+    } else {
+      JumpRow = (int64_t)idx;
+    }
+    ScrollToJump = true;
+  }
+
+  void DrawToolbar() {
+    ImGui::SetNextItemWidth(-160.0f);
+    bool open = ImGui::InputTextWithHint("##path", "Archive path (.sal)",
+                                         PathBuf, sizeof(PathBuf),
+                                         ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    open |= ImGui::Button("Open");
+    ImGui::SameLine();
+    if (ImGui::Button("Browse...")) {
+      IGFD::FileDialogConfig config;
+      config.path = "logs";
+      ImGuiFileDialog::Instance()->OpenDialog(
+          "OpenArchiveDlg", "Open Log Archive", ".sal", config);
+    }
+    if (open && PathBuf[0] != '\0')
+      OpenArchive(PathBuf);
+
+    if (ImGuiFileDialog::Instance()->Display("OpenArchiveDlg",
+                                             ImGuiWindowFlags_NoCollapse,
+                                             ImVec2(700, 450))) {
+      if (ImGuiFileDialog::Instance()->IsOk())
+        OpenArchive(ImGuiFileDialog::Instance()->GetFilePathName());
+      ImGuiFileDialog::Instance()->Close();
+    }
+  }
+
+  void DrawFilters() {
+    bool changed = Filter.Draw("Filter", 200.0f);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(150.0f);
+    const char *preview =
+        SelectedChannel < 0
+            ? "All channels"
+            : Archive.ChannelName((uint16_t)SelectedChannel).c_str();
+    if (ImGui::BeginCombo("##channel", preview)) {
+      if (ImGui::Selectable("All channels", SelectedChannel < 0)) {
+        SelectedChannel = -1;
+        changed = true;
+      }
+      for (size_t i = 0; i < Archive.ChannelCount(); i++) {
+        if (ImGui::Selectable(Archive.ChannelName((uint16_t)i).c_str(),
+                              SelectedChannel == (int)i)) {
+          SelectedChannel = (int)i;
+          changed = true;
+        }
+      }
+      ImGui::EndCombo();
+    }
+    if (changed)
+      StartFilter();
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(90.0f);
+    bool jump = ImGui::InputTextWithHint("##jump", "HH:MM:SS", JumpBuf,
+                                         sizeof(JumpBuf),
+                                         ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    jump |= ImGui::Button("Go");
+    int64_t target;
+    if (jump && ParseJumpTime(target))
+      JumpTo(target);
+  }
+
+  void DrawRow(uint64_t recordIdx, bool highlighted) {
+    LogArchiveRecord rec = Archive.Record(recordIdx);
+    char timeText[32];
+    LogWindow::FormatTime(rec.timeMs, timeText, sizeof(timeText));
+    if (highlighted)
+      ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 220, 80, 255));
+    else
+      ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(
+                                               ImGuiCol_TextDisabled));
+    ImGui::TextUnformatted(timeText);
+    ImGui::PopStyleColor();
+    ImGui::SameLine();
+    ImGui::TextDisabled("[%s]", Archive.ChannelName(rec.channel).c_str());
+    ImGui::SameLine();
+    std::string_view msg = Archive.Message(rec);
+    const char *msgEnd, *fullEnd = msg.data() + msg.size();
+    int moreLines = LogWindow::FirstLine(msg.data(), fullEnd, msgEnd);
+    ImGui::BeginGroup();
+    ImGui::PushStyleColor(ImGuiCol_Text, rec.color);
+    ImGui::TextUnformatted(msg.data(), msgEnd);
+    ImGui::PopStyleColor();
+    if (moreLines > 0) {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(+%d lines)", moreLines);
+    }
+    ImGui::EndGroup();
+    if (moreLines > 0 && ImGui::IsItemHovered()) {
+      ImGui::BeginTooltip();
+      ImGui::TextUnformatted(msg.data(), fullEnd);
+      ImGui::EndTooltip();
+    }
+  }
+
+public:
+  ~LogArchiveWindow() { CancelPass(); }
+
+  void Draw(const char *title, bool *p_open = nullptr) {
+    ImGui::SetNextWindowSize(ImVec2(800, 500), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(title, p_open)) {
+      ImGui::End();
+      return;
+    }
+
+    DrawToolbar();
+    if (!Archive.IsOpen()) {
+      if (!Archive.Error().empty())
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s",
+                           Archive.Error().c_str());
+      ImGui::End();
+      return;
+    }
+
+    DrawFilters();
+    Collect();
+
+    char first[32], last[32];
+    LogWindow::FormatTime(Archive.FirstTime(), first, sizeof(first));
+    LogWindow::FormatTime(Archive.LastTime(), last, sizeof(last));
+    ImGui::TextDisabled("%llu records, %.1f MB, %s - %s",
+                        (unsigned long long)Archive.Size(),
+                        Archive.FileSize() / (1024.0 * 1024.0), first, last);
+    if (Filtered) {
+      ImGui::SameLine();
+      if (Pass && !Pass->done) {
+        float progress = Archive.Size() ? (float)Pass->scanned /
+                                              (float)Archive.Size()
+                                        : 1.0f;
+        ImGui::ProgressBar(progress, ImVec2(120, 0), "Filtering...");
+        ImGui::SameLine();
+      }
+      ImGui::TextDisabled("%zu matches", Rows.size());
+    }
+    ImGui::Separator();
+
+    ImGui::BeginChild("ArchiveRows", ImVec2(0, 0), false,
+                      ImGuiWindowFlags_HorizontalScrollbar);
+    uint64_t rowCount = Filtered ? Rows.size() : Archive.Size();
+    // the clipper counts rows in int
+    if (rowCount > (uint64_t)INT32_MAX)
+      rowCount = INT32_MAX;
+    float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+    if (ScrollToJump && JumpRow >= 0) {
+      ImGui::SetScrollY((float)JumpRow * lineHeight);
+      ScrollToJump = false;
+    }
+    ImGuiListClipper clipper;
+    clipper.Begin((int)rowCount, lineHeight);
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        uint64_t idx = Filtered ? Rows[row] : (uint64_t)row;
+        DrawRow(idx, row == JumpRow);
+      }
+    }
+    clipper.End();
+    ImGui::EndChild();
+
+    ImGui::End();
+  }
+};
@@ -1,24 +1,32 @@
 #pragma once
+#include "../tools/LocalTime.hpp"
+#include "../tools/LogCoalescer.hpp"
+#include "../tools/LogFilterWorker.hpp"
+#include "../tools/LogQuery.hpp"
+#include "../tools/LogRateHistory.hpp"
+#include "../tools/LogStore.hpp"
+#include "../tools/LogTriggers.hpp"
+#include "../tools/LogTrigramIndex.hpp"
+#include "../tools/RangeSelection.hpp"
 #include "imgui.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
-#include <set>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-struct LogEntry {
-  std::string msg;
-  std::string category;
-  int32_t colorCode;
-};
-
 class LogWindow {
-  std::vector<LogEntry> Items;
-  std::vector<int> DisplayIndices;
-  std::set<std::string> Categories;
+  LogStore Store;
+  std::vector<size_t> DisplayIndices; // store indices of the shown rows
 
-  std::set<int> SelectedItemsIndices;
+  // selection is kept as intervals of display rows, so it is dropped whenever
+  // the filtered list is rebuilt
+  RangeSelection Selection;
   int FocusedDisplayIdx = -1;
   int AnchorDisplayIdx = -1;
   bool RequestScrollToFocus = false;
@@ -28,49 +36,330 @@ class LogWindow {
   bool AutoScroll = true;
   bool ScrollToBottom = false;
 
-  std::string SelectedCategory = "ALL";
+  int SelectedCategory = LogCategoryTable::All;
   bool NeedsFilterUpdate = false;
 
-  ImVec4 GetColorForCode(int32_t col) const {
-    if (col == 0)
-      return ImVec4(0.9f, 0.9f, 0.9f, 1.0f);
-    int r = (col >> 16) & 0xFF;
-    int g = (col >> 8) & 0xFF;
-    int b = col & 0xFF;
-    return ImVec4(r / 255.0f, g / 255.0f, b / 255.0f, 1.0f);
+  // filtering runs in the background; lines that arrive while a pass is
+  // running are matched right away and appended once the pass is done
+  LogFilterWorker FilterWorker;
+  LogQuery ActiveQuery;
+  bool FilterPassRunning = false;
+  std::vector<size_t> PendingTail;
+
+  LogTrigramIndex Index;
+  LogCoalescer Coalescer;
+
+  // lines marked by a highlighting trigger, with their colour
+  LogTriggers *Triggers = nullptr;
+  std::unordered_map<size_t, uint32_t> Highlights;
+
+  bool ShowTimestamps = false;
+  LogRateHistory Rates;
+  float RateBuffer[LogRateHistory::HistorySeconds];
+  std::vector<std::pair<float, uint16_t>> RateRows;
+  size_t KnownBegin = 0;
+  int RetentionLines = 0; // LogStore::MaxLines, 0 = no limit
+  int SpillBudgetMB = 0;
+
+  // copying a large selection is spread over several frames
+  static constexpr int CopyRowsPerFrame = 50000;
+  static constexpr size_t MaxCopyBytes = 64u << 20;
+  bool Copying = false;
+  RangeSelection CopyRows;
+  int CopyNext = 0;
+  size_t CopyTotal = 0;
+  size_t CopyDone = 0;
+  std::string CopyBuffer;
+  std::string CopyStatus;
+
+  // timing of the last completed search, shown in the stats tooltip
+  std::chrono::steady_clock::time_point SearchStart;
+  double LastSearchMs = 0.0;
+  bool LastSearchIndexed = false;
+  size_t LastSearchCandidates = 0;
+
+  bool PassesFilter(const LogRecord &item) {
+    if (ActiveQuery.BoundCategories() != Store.Categories.Size())
+      ActiveQuery.BindCategories(Store.Categories);
+    return ActiveQuery.Matches(Store, item);
   }
 
   void RebuildFilteredList() {
-    DisplayIndices.clear();
-    for (int i = 0; i < Items.size(); i++) {
-      const auto &item = Items[i];
-      if (SelectedCategory != "ALL" && item.category != SelectedCategory)
-        continue;
-      if (!Filter.PassFilter(item.msg.c_str()) &&
-          !Filter.PassFilter(item.category.c_str()))
-        continue;
-      DisplayIndices.push_back(i);
+    LogQuery query(Filter.InputBuf, SelectedCategory);
+    query.BindCategories(Store.Categories);
+
+    // a narrower query only has to look at what the previous one matched
+    bool refine = !FilterPassRunning && query.IsRefinementOf(ActiveQuery);
+    ActiveQuery = query;
+
+    std::vector<size_t> previous;
+    previous.swap(DisplayIndices);
+    PendingTail.clear();
+
+    SearchStart = std::chrono::steady_clock::now();
+    LastSearchIndexed = Index.CanAnswer(ActiveQuery);
+
+    if (LastSearchIndexed) {
+      std::vector<size_t> candidates =
+          Index.Candidates(ActiveQuery, Store.Begin(), Store.End());
+      if (refine && previous.size() < candidates.size())
+        candidates.swap(previous);
+      LastSearchCandidates = candidates.size();
+      FilterWorker.FilterCandidates(Store, ActiveQuery, std::move(candidates));
+    } else if (refine) {
+      LastSearchCandidates = previous.size();
+      FilterWorker.FilterCandidates(Store, ActiveQuery, std::move(previous));
+    } else {
+      LastSearchCandidates = Store.Size();
+      FilterWorker.FilterRange(Store, ActiveQuery, Store.Begin(), Store.End());
     }
+    FilterPassRunning = true;
+
     FocusedDisplayIdx = -1;
     AnchorDisplayIdx = -1;
-    if (AutoScroll)
+    Selection.Clear();
+    if (Copying)
+      FinishCopy("Copy cancelled, the list was filtered again");
+  }
+
+  void CollectFilterResults() {
+    if (!FilterPassRunning)
+      return;
+    size_t before = DisplayIndices.size();
+    if (FilterWorker.Collect(DisplayIndices)) {
+      DisplayIndices.insert(DisplayIndices.end(), PendingTail.begin(),
+                            PendingTail.end());
+      PendingTail.clear();
+      FilterPassRunning = false;
+      LastSearchMs = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - SearchStart)
+                         .count();
+    }
+    // the pass may have matched lines that were evicted in the meantime
+    PruneEvicted();
+    if (AutoScroll && DisplayIndices.size() != before)
       ScrollToBottom = true;
   }
 
+  // Drops everything that refers to lines the store has evicted. Display
+  // positions shift down by the number of rows removed from the front.
+  void PruneEvicted() {
+    size_t begin = Store.Begin();
+    if (begin != KnownBegin) {
+      Index.Evict(begin);
+      Coalescer.Evict(begin);
+      for (auto it = Highlights.begin(); it != Highlights.end();) {
+        if (it->first < begin)
+          it = Highlights.erase(it);
+        else
+          ++it;
+      }
+      KnownBegin = begin;
+    }
+
+    auto stale = [begin](const std::vector<size_t> &v) {
+      return !v.empty() && v.front() < begin;
+    };
+    if (!stale(DisplayIndices) && !stale(PendingTail))
+      return;
+
+    auto evicted = [begin](std::vector<size_t> &v) {
+      return std::lower_bound(v.begin(), v.end(), begin);
+    };
+    int removed = (int)(evicted(DisplayIndices) - DisplayIndices.begin());
+    DisplayIndices.erase(DisplayIndices.begin(), evicted(DisplayIndices));
+    PendingTail.erase(PendingTail.begin(), evicted(PendingTail));
+    Selection.DropFront(removed);
+    CopyRows.DropFront(removed);
+    CopyNext = std::max(CopyNext - removed, 0);
+
+    FocusedDisplayIdx = std::max(FocusedDisplayIdx - removed, -1);
+    AnchorDisplayIdx = std::max(AnchorDisplayIdx - removed, -1);
+  }
+
+  void RebuildIndex() {
+    Index.Clear();
+    for (size_t i = Store.Begin(); i < Store.End(); i++)
+      Index.Add(i, Store.Message(Store[i]));
+  }
+
+  void DrawOptions() {
+    if (ImGui::Button("Options"))
+      ImGui::OpenPopup("LogOptions");
+    if (!ImGui::BeginPopup("LogOptions"))
+      return;
+
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::InputInt("Max lines", &RetentionLines, 100000, 1000000,
+                        ImGuiInputTextFlags_EnterReturnsTrue)) {
+      if (RetentionLines > 0)
+        RetentionLines = std::clamp(
+            RetentionLines, 10000,
+            (int)std::min<size_t>(LogStore::MaxRetention, INT32_MAX));
+      else
+        RetentionLines = 0;
+      Store.MaxLines = (size_t)RetentionLines;
+    }
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Oldest lines are dropped once this many are kept, "
+                        "0 = no limit.\nEven then the oldest go past %zu "
+                        "lines.",
+                        LogStore::MaxRetention);
+
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::InputInt("Spill above (MB)", &SpillBudgetMB, 64, 256,
+                        ImGuiInputTextFlags_EnterReturnsTrue)) {
+      SpillBudgetMB = std::clamp(SpillBudgetMB, 0, 1 << 20);
+      Store.SetMemoryBudget((size_t)SpillBudgetMB << 20);
+    }
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Message text beyond this budget is paged out to a "
+                        "temp file and read back when needed, 0 = off.\n"
+                        "Raise Max lines to keep more history.");
+
+    bool indexed = Index.Enabled;
+    if (ImGui::Checkbox("Substring index", &indexed)) {
+      Index.Enabled = indexed;
+      if (indexed)
+        RebuildIndex();
+      else
+        Index.Clear();
+    }
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Speeds up searches for terms of 3+ characters.\n"
+                        "Costs about 4 bytes per character kept, several "
+                        "times the log itself.");
+
+    ImGui::Checkbox("Show timestamps", &ShowTimestamps);
+
+    const char *modes[] = {"Off", "Consecutive", "Recent lines"};
+    int mode = (int)Coalescer.GetMode();
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::Combo("Collapse repeats", &mode, modes, IM_ARRAYSIZE(modes)))
+      Coalescer.SetMode((CoalesceMode)mode);
+    if (Coalescer.GetMode() == CoalesceMode::RecentWindow) {
+      ImGui::SetNextItemWidth(150);
+      if (ImGui::InputInt("Window", &Coalescer.Window))
+        Coalescer.Window = std::clamp(Coalescer.Window, 1, 4096);
+      if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("How many distinct lines per channel are checked");
+    }
+    ImGui::EndPopup();
+  }
+
+  // per-channel lines/sec over the last couple of minutes, busiest first
+  void DrawRates() {
+    if (!ImGui::CollapsingHeader("Line rate"))
+      return;
+
+    const int maxRows = 8;
+    int64_t now = NowMs();
+    RateRows.clear();
+    for (size_t id = 0; id < Rates.ChannelCount(); id++) {
+      float peak = Rates.Series((uint16_t)id, now, RateBuffer);
+      if (peak > 0.0f)
+        RateRows.emplace_back(peak, (uint16_t)id);
+    }
+    if (RateRows.empty()) {
+      ImGui::TextDisabled("No lines in the last %d seconds",
+                          LogRateHistory::HistorySeconds);
+      return;
+    }
+    std::sort(RateRows.begin(), RateRows.end(),
+              [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    for (size_t r = 0; r < RateRows.size() && r < maxRows; r++) {
+      auto [peak, id] = RateRows[r];
+      Rates.Series(id, now, RateBuffer);
+
+      char overlay[128];
+      snprintf(overlay, sizeof(overlay), "%s  %.0f/s (peak %.0f/s)",
+               id == 0 ? "(no channel)" : Store.Categories.Name(id).c_str(),
+               RateBuffer[LogRateHistory::HistorySeconds - 1], peak);
+
+      ImGui::PushID(id);
+      ImGui::SetNextItemWidth(-FLT_MIN);
+      ImGui::PlotLines("##rate", RateBuffer, LogRateHistory::HistorySeconds, 0,
+                       overlay, 0.0f, peak * 1.1f, ImVec2(0, 36));
+      ImGui::PopID();
+    }
+    if (RateRows.size() > maxRows)
+      ImGui::TextDisabled("%zu quieter channels not shown",
+                          RateRows.size() - maxRows);
+  }
+
   void CopySelectedToClipboard() {
-    if (SelectedItemsIndices.empty())
+    if (Selection.Empty() || Copying)
       return;
-    std::string clipboardText;
-    for (int idx : SelectedItemsIndices) {
-      if (idx >= 0 && idx < Items.size()) {
-        const auto &item = Items[idx];
-        if (!item.category.empty())
-          clipboardText += "[" + item.category + "] ";
-        clipboardText += item.msg + "\n";
+    Copying = true;
+    CopyRows = Selection;
+    CopyNext = 0;
+    CopyTotal = Selection.Count();
+    CopyDone = 0;
+    CopyBuffer.clear();
+    CopyStatus.clear();
+  }
+
+  void FinishCopy(const char *status) {
+    Copying = false;
+    CopyRows.Clear();
+    CopyBuffer.clear();
+    CopyBuffer.shrink_to_fit();
+    CopyStatus = status;
+  }
+
+  // appends the next batch of selected rows to the copy buffer and hands it
+  // to the clipboard once everything (or the size cap) is reached
+  void ContinueCopy() {
+    if (!Copying)
+      return;
+
+    int budget = CopyRowsPerFrame;
+    bool truncated = false;
+    for (const auto &range : CopyRows.Get()) {
+      if (range.second < CopyNext)
+        continue;
+      int last = std::min(range.second, (int)DisplayIndices.size() - 1);
+      for (int i = std::max(range.first, CopyNext); i <= last; i++) {
+        if (budget-- == 0)
+          return;
+        CopyNext = i + 1;
+        CopyDone++;
+
+        const auto &item = Store[DisplayIndices[i]];
+        if (ShowTimestamps) {
+          char timeText[32];
+          FormatTime(Store.Time(DisplayIndices[i]), timeText, sizeof(timeText));
+          CopyBuffer += timeText;
+          CopyBuffer += ' ';
+        }
+        CopyBuffer += Store.Categories.Prefix(item.category);
+        CopyBuffer += Store.Message(item);
+        if (const LogRepeat *rep = Coalescer.Find(DisplayIndices[i])) {
+          char suffix[32];
+          snprintf(suffix, sizeof(suffix), " (x%u)", rep->count);
+          CopyBuffer += suffix;
+        }
+        CopyBuffer += '\n';
+        if (CopyBuffer.size() >= MaxCopyBytes) {
+          truncated = true;
+          break;
+        }
       }
+      if (truncated)
+        break;
     }
-    if (!clipboardText.empty())
-      ImGui::SetClipboardText(clipboardText.c_str());
+
+    if (!CopyBuffer.empty())
+      ImGui::SetClipboardText(CopyBuffer.c_str());
+
+    char status[96];
+    if (truncated)
+      snprintf(status, sizeof(status), "Copied %zu of %zu lines (%zu MB limit)",
+               CopyDone, CopyTotal, MaxCopyBytes >> 20);
+    else
+      snprintf(status, sizeof(status), "Copied %zu lines", CopyDone);
+    FinishCopy(status);
   }
 
   void SelectRange(int startDisplayIdx, int endDisplayIdx) {
@@ -80,10 +369,8 @@ class LogWindow {
       first = 0;
     if (last >= DisplayIndices.size())
       last = (int)DisplayIndices.size() - 1;
-
-    for (int i = first; i <= last; i++) {
-      SelectedItemsIndices.insert(DisplayIndices[i]);
-    }
+    if (first <= last)
+      Selection.Add(first, last);
   }
 
   void HandleDragAutoscroll() {
@@ -118,9 +405,9 @@ class LogWindow {
       CopySelectedToClipboard();
 
     if (ImGui::IsKeyPressed(ImGuiKey_A) && ctrl) {
-      SelectedItemsIndices.clear();
-      for (int idx : DisplayIndices)
-        SelectedItemsIndices.insert(idx);
+      Selection.Clear();
+      if (!DisplayIndices.empty())
+        Selection.Add(0, (int)DisplayIndices.size() - 1);
     }
 
     int moveDir = 0;
@@ -148,11 +435,11 @@ class LogWindow {
           if (AnchorDisplayIdx == -1)
             AnchorDisplayIdx = FocusedDisplayIdx;
           if (!ctrl)
-            SelectedItemsIndices.clear();
+            Selection.Clear();
           SelectRange(AnchorDisplayIdx, FocusedDisplayIdx);
         } else {
-          SelectedItemsIndices.clear();
-          SelectedItemsIndices.insert(DisplayIndices[FocusedDisplayIdx]);
+          Selection.Clear();
+          Selection.Add(FocusedDisplayIdx, FocusedDisplayIdx);
           AnchorDisplayIdx = FocusedDisplayIdx;
         }
       }
@@ -160,39 +447,112 @@ class LogWindow {
   }
 
 public:
-  LogWindow() { Categories.insert("ALL"); }
+  static int64_t NowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static void FormatTime(int64_t ms, char *buf, size_t size) {
+    time_t secs = (time_t)(ms / 1000);
+    std::tm t;
+    if (!LocalTime(secs, t)) {
+      snprintf(buf, size, "?");
+      return;
+    }
+    snprintf(buf, size, "%02d:%02d:%02d.%03d", t.tm_hour, t.tm_min, t.tm_sec,
+             (int)(ms % 1000));
+  }
+
+  // Rows are one line tall for the clipper, so multi-line messages
+  // (tracebacks) show their first line and the rest on hover. Returns
+  // where that line ends and how many lines follow it.
+  static int FirstLine(const char *msg, const char *end,
+                       const char *&lineEnd) {
+    lineEnd = (const char *)memchr(msg, '\n', end - msg);
+    if (!lineEnd) {
+      lineEnd = end;
+      return 0;
+    }
+    int more = (int)std::count(lineEnd, end, '\n');
+    if (end[-1] == '\n')
+      more--;
+    if (lineEnd > msg && lineEnd[-1] == '\r')
+      lineEnd--;
+    return more;
+  }
+
+  // converted once when the line arrives, rows just use the stored value
+  static ImU32 GetColorForCode(int32_t col) {
+    if (col == 0)
+      return IM_COL32(230, 230, 230, 255);
+    return IM_COL32((col >> 16) & 0xFF, (col >> 8) & 0xFF, col & 0xFF, 255);
+  }
+
+  // read-only access for views that share this window's lines
+  const LogStore &GetStore() const { return Store; }
+
+  // every added line is also matched against these triggers
+  void SetTriggers(LogTriggers *triggers) { Triggers = triggers; }
 
   void Clear() {
-    Items.clear();
+    FilterWorker.Cancel(true);
+    FilterPassRunning = false;
+    PendingTail.clear();
+    Store.Clear();
+    Index.Clear();
+    Coalescer.Clear();
+    Rates.Clear();
+    Highlights.clear();
+    KnownBegin = 0;
     DisplayIndices.clear();
-    SelectedItemsIndices.clear();
-    Categories.clear();
-    Categories.insert("ALL");
-    SelectedCategory = "ALL";
+    Selection.Clear();
+    if (Copying)
+      FinishCopy("");
+    CopyStatus.clear();
+    SelectedCategory = LogCategoryTable::All;
     FocusedDisplayIdx = -1;
     AnchorDisplayIdx = -1;
   }
 
+  // timeMs is when the line was received, 0 means now
   void AddLog(const std::string &msg, const std::string &category,
-              int32_t colorCode) {
-    Items.push_back({msg, category, colorCode});
-
-    if (!category.empty() && Categories.find(category) == Categories.end()) {
-      Categories.insert(category);
+              int32_t colorCode, int64_t timeMs = 0) {
+    if (timeMs == 0)
+      timeMs = NowMs();
+    uint32_t color = GetColorForCode(colorCode);
+    uint16_t categoryId = Store.Categories.Intern(category);
+    Rates.Count(categoryId, timeMs);
+    uint32_t highlight = Triggers ? Triggers->Scan(category, msg, timeMs) : 0;
+
+    // a repeat only bumps the counter of the line it repeats
+    size_t repeated = Coalescer.Merge(Store, categoryId, msg, color, timeMs);
+    if (repeated != SIZE_MAX) {
+      if (highlight)
+        Highlights[repeated] = highlight;
+      return;
     }
 
-    bool catMatch = (SelectedCategory == "ALL" || category == SelectedCategory);
-    bool filterMatch =
-        Filter.PassFilter(msg.c_str()) || Filter.PassFilter(category.c_str());
-
-    if (catMatch && filterMatch) {
-      DisplayIndices.push_back((int)Items.size() - 1);
+    size_t idx = Store.Add(msg, category, color, timeMs);
+    if (highlight)
+      Highlights[idx] = highlight;
+    Coalescer.Remember(categoryId, idx, msg, color, timeMs);
+    Index.Add(idx, Store.Message(Store[idx]));
+    PruneEvicted();
+
+    if (PassesFilter(Store[idx])) {
+      if (FilterPassRunning) {
+        PendingTail.push_back(idx);
+        return;
+      }
+      DisplayIndices.push_back(idx);
       if (AutoScroll)
         ScrollToBottom = true;
     }
   }
 
   void Draw(const char *title, bool *p_open = nullptr) {
+    Store.Maintain();
     if (!ImGui::Begin(title, p_open)) {
       ImGui::End();
       return;
@@ -210,11 +570,45 @@ public:
     }
     ImGui::SameLine();
 
+    ImGui::TextDisabled("%zu lines", Store.Size());
+    if (ImGui::IsItemHovered()) {
+      double mb = Store.MemoryUsage() / (1024.0 * 1024.0);
+      double perMillion =
+          Store.Empty() ? 0.0 : mb * 1000000.0 / (double)Store.Size();
+      double indexMb = Index.MemoryUsage() / (1024.0 * 1024.0);
+      double spilledMb = Store.SpilledBytes() / (1024.0 * 1024.0);
+      ImGui::SetTooltip("Memory: %.1f MB\n~%.1f MB per 1M lines\n"
+                        "On disk: %.1f MB\nIndex: %.1f MB\n"
+                        "Last search: %.2f ms (%s, %zu lines checked)",
+                        mb, perMillion, spilledMb, indexMb, LastSearchMs,
+                        LastSearchIndexed ? "index" : "scan",
+                        LastSearchCandidates);
+    }
+    ImGui::SameLine();
+    if (Copying) {
+      float progress = CopyTotal ? (float)CopyDone / (float)CopyTotal : 1.0f;
+      ImGui::ProgressBar(progress, ImVec2(120, 0), "Copying...");
+      ImGui::SameLine();
+    } else if (!CopyStatus.empty()) {
+      ImGui::TextDisabled("%s", CopyStatus.c_str());
+      ImGui::SameLine();
+    }
+    DrawOptions();
+    ImGui::SameLine();
+
+    const char *preview = SelectedCategory == LogCategoryTable::All
+                              ? "ALL"
+                              : Store.Categories.Name(SelectedCategory).c_str();
     ImGui::SetNextItemWidth(150);
-    if (ImGui::BeginCombo("##cat", SelectedCategory.c_str())) {
-      for (const auto &cat : Categories) {
-        if (ImGui::Selectable(cat.c_str(), SelectedCategory == cat)) {
-          SelectedCategory = cat;
+    if (ImGui::BeginCombo("##cat", preview)) {
+      if (ImGui::Selectable("ALL", SelectedCategory == LogCategoryTable::All)) {
+        SelectedCategory = LogCategoryTable::All;
+        NeedsFilterUpdate = true;
+      }
+      for (uint16_t id : Store.Categories.Sorted()) {
+        if (ImGui::Selectable(Store.Categories.Name(id).c_str(),
+                              SelectedCategory == id)) {
+          SelectedCategory = id;
           NeedsFilterUpdate = true;
         }
       }
@@ -228,7 +622,15 @@ public:
       RebuildFilteredList();
       NeedsFilterUpdate = false;
     }
-    ImGui::Separator();
+    CollectFilterResults();
+    ContinueCopy();
+
+    DrawRates();
+
+    if (FilterPassRunning)
+      ImGui::ProgressBar(FilterWorker.Progress(), ImVec2(-FLT_MIN, 4.0f), "");
+    else
+      ImGui::Separator();
 
     ImGui::BeginChild("ScrollingRegion", ImVec2(0, 0), false,
                       ImGuiWindowFlags_HorizontalScrollbar);
@@ -249,26 +651,103 @@ public:
     ImGui::PushStyleColor(ImGuiCol_HeaderActive, headerActiveCol);
     ImGui::PushStyleColor(ImGuiCol_HeaderHovered, headerHover);
 
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    float rowWidth = ImGui::GetContentRegionAvail().x;
+
     ImGuiListClipper clipper;
     clipper.Begin(DisplayIndices.size());
 
     while (clipper.Step()) {
       for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
-        int realIdx = DisplayIndices[i];
-        const auto &item = Items[realIdx];
-
-        ImVec4 col = GetColorForCode(item.colorCode);
-
-        ImGui::PushID(realIdx);
-        bool is_selected = SelectedItemsIndices.count(realIdx);
+        size_t realIdx = DisplayIndices[i];
+        const auto &item = Store[realIdx];
+
+        ImGui::PushID((void *)(uintptr_t)realIdx);
+        bool is_selected = Selection.Contains(i);
+
+        // the row text goes straight from the store to the draw list, the
+        // selectable only provides the hit box and highlight
+        const std::string &prefix = Store.Categories.Prefix(item.category);
+        const char *msg = Store.MessageCStr(item);
+        const char *fullEnd = msg + item.length;
+        const char *msgEnd;
+        int moreLines = FirstLine(msg, fullEnd, msgEnd);
+        char moreText[32];
+        float moreWidth = 0.0f;
+        if (moreLines > 0) {
+          snprintf(moreText, sizeof(moreText), "  (+%d lines)", moreLines);
+          moreWidth = ImGui::CalcTextSize(moreText).x;
+        }
+        float prefixWidth =
+            prefix.empty() ? 0.0f : ImGui::CalcTextSize(prefix.c_str()).x;
+        float textWidth = prefixWidth + ImGui::CalcTextSize(msg, msgEnd).x;
+
+        const LogRepeat *repeat = Coalescer.Find(realIdx);
+        char repeatText[32];
+        float repeatWidth = 0.0f;
+        if (repeat) {
+          snprintf(repeatText, sizeof(repeatText), "  x%u", repeat->count);
+          repeatWidth = ImGui::CalcTextSize(repeatText).x;
+        }
 
-        ImGui::PushStyleColor(ImGuiCol_Text, col);
-        std::string label = item.category.empty()
-                                ? item.msg
-                                : ("[" + item.category + "] " + item.msg);
+        char timeText[32];
+        float timeWidth = 0.0f;
+        if (ShowTimestamps) {
+          FormatTime(Store.Time(realIdx), timeText, sizeof(timeText));
+          timeWidth = ImGui::CalcTextSize(timeText).x +
+                      ImGui::GetStyle().ItemSpacing.x;
+        }
 
-        ImGui::Selectable(label.c_str(), is_selected,
-                          ImGuiSelectableFlags_SpanAllColumns);
+        ImVec2 rowPos = ImGui::GetCursorScreenPos();
+        float rowExtent =
+            std::max(timeWidth + textWidth + moreWidth + repeatWidth, rowWidth);
+        if (!Highlights.empty()) {
+          auto mark = Highlights.find(realIdx);
+          if (mark != Highlights.end())
+            drawList->AddRectFilled(
+                rowPos,
+                ImVec2(rowPos.x + rowExtent,
+                       rowPos.y + ImGui::GetTextLineHeight()),
+                mark->second);
+        }
+        ImGui::Selectable("##row", is_selected,
+                          ImGuiSelectableFlags_SpanAllColumns,
+                          ImVec2(rowExtent, 0.0f));
+
+        if (ShowTimestamps)
+          drawList->AddText(rowPos, ImGui::GetColorU32(ImGuiCol_TextDisabled),
+                            timeText);
+        ImVec2 textPos(rowPos.x + timeWidth, rowPos.y);
+
+        if (!prefix.empty())
+          drawList->AddText(textPos, item.color, prefix.c_str(),
+                            prefix.c_str() + prefix.size());
+        drawList->AddText(ImVec2(textPos.x + prefixWidth, textPos.y),
+                          item.color, msg, msgEnd);
+
+        if (moreLines > 0)
+          drawList->AddText(ImVec2(textPos.x + textWidth, textPos.y),
+                            ImGui::GetColorU32(ImGuiCol_TextDisabled),
+                            moreText);
+        if (repeat)
+          drawList->AddText(
+              ImVec2(textPos.x + textWidth + moreWidth, textPos.y),
+              ImGui::GetColorU32(ImGuiCol_TextDisabled), repeatText);
+        if ((repeat || moreLines > 0) && ImGui::IsItemHovered()) {
+          ImGui::BeginTooltip();
+          if (moreLines > 0)
+            ImGui::TextUnformatted(msg, fullEnd);
+          if (repeat) {
+            char first[32], last[32];
+            FormatTime(repeat->firstMs, first, sizeof(first));
+            FormatTime(repeat->lastMs, last, sizeof(last));
+            if (moreLines > 0)
+              ImGui::Separator();
+            ImGui::Text("Repeated %u times\nFirst: %s\nLast:  %s",
+                        repeat->count, first, last);
+          }
+          ImGui::EndTooltip();
+        }
 
         ImVec2 itemMin = ImGui::GetItemRectMin();
         ImVec2 itemMax = ImGui::GetItemRectMax();
@@ -282,18 +761,15 @@ public:
               if (AnchorDisplayIdx == -1)
                 AnchorDisplayIdx = i;
               if (!ImGui::GetIO().KeyCtrl)
-                SelectedItemsIndices.clear();
+                Selection.Clear();
               SelectRange(AnchorDisplayIdx, i);
             } else if (ImGui::GetIO().KeyCtrl) {
               AnchorDisplayIdx = i;
-              if (is_selected)
-                SelectedItemsIndices.erase(realIdx);
-              else
-                SelectedItemsIndices.insert(realIdx);
+              Selection.Toggle(i);
             } else {
               AnchorDisplayIdx = i;
-              SelectedItemsIndices.clear();
-              SelectedItemsIndices.insert(realIdx);
+              Selection.Clear();
+              Selection.Add(i, i);
             }
           }
         }
@@ -306,15 +782,13 @@ public:
 
               if (AnchorDisplayIdx != -1) {
                 if (!ImGui::GetIO().KeyCtrl)
-                  SelectedItemsIndices.clear();
+                  Selection.Clear();
                 SelectRange(AnchorDisplayIdx, i);
               }
             }
           }
         }
 
-        ImGui::PopStyleColor();
-
         if (RequestScrollToFocus && i == FocusedDisplayIdx) {
           ImGui::SetScrollHereY();
           RequestScrollToFocus = false;
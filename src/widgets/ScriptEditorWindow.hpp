@@ -1,6 +1,8 @@
 #pragma once
 #include "../tools/AsyncLuaLinter.hpp"
 #include "../tools/GlobalsManager.hpp"
+#include "../tools/LuaLint.hpp"
+#include "../tools/ScriptAPI.hpp"
 #include "../tools/ScriptEditorAutocomplete.hpp"
 #include "ImGuiFileDialog.h"
 #include "TextDiff.h"
@@ -18,6 +20,8 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -667,6 +671,65 @@ class ScriptEditorWindow {
   AsyncLuaLinter linter;
   GlobalsManager globalsManager;
   bool RealTimeLinting = true;
+  bool DeepLinting = true; // luacheck on top of the built-in pass
+  bool ContinuousAnalysis = true; // project results kept current
+  LuaLint::Options QuickLintOptions;
+  std::unordered_set<std::string> EngineFunctionNames;
+  double QuickLintMs = 0.0;
+
+  // The built-in pass knows what the generated .luacheckrc declares, plus
+  // the engine functions, and skips what it ignores.
+  void SetupQuickLint() {
+    for (const auto &func : ScriptAPI::Database::GetEngineFunctions()) {
+      // a few names carry their C return type, e.g. "float\tName"
+      std::string_view name = func.Name;
+      size_t space = name.find_last_of(" \t");
+      if (space != std::string_view::npos)
+        name.remove_prefix(space + 1);
+      EngineFunctionNames.emplace(name);
+    }
+    QuickLintOptions.isKnownGlobal = [this](const std::string &name) {
+      return globalsManager.IsKnownGlobal(name) ||
+             EngineFunctionNames.count(name) > 0;
+    };
+    const auto &ignored = GlobalsManager::IgnoredWarnings();
+    QuickLintOptions.ignore.insert(ignored.begin(), ignored.end());
+  }
+
+  // The background sweep runs the built-in pass itself when there is no
+  // luacheck, on its own thread, so it gets a copy of what's known.
+  size_t FallbackRevision = (size_t)-1;
+  void UpdateBackgroundFallback() {
+    if (FallbackRevision == globalsManager.GetRevision())
+      return;
+    FallbackRevision = globalsManager.GetRevision();
+    auto known = std::make_shared<std::unordered_set<std::string>>(
+        globalsManager.KnownGlobals());
+    known->insert(EngineFunctionNames.begin(), EngineFunctionNames.end());
+    LuaLint::Options options;
+    options.isKnownGlobal = [known](const std::string &name) {
+      return known->count(name) > 0;
+    };
+    options.ignore = QuickLintOptions.ignore;
+    linter.SetBackgroundFallback(std::move(options));
+  }
+
+  void ShowLintResults(ScriptDocument &doc, std::vector<LintResult> results) {
+    doc.LintWarnings = std::move(results);
+    doc.RefreshMarkers(GlobalBreakpoints[doc.RelativePathLower],
+                       GlobalErrors[doc.RelativePathLower]);
+  }
+
+  // instant results, replaced by luacheck's once they are in
+  void QuickLint(ScriptDocument &doc, const std::string &text) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<LintResult> results;
+    LuaLint::Check(text, doc.FullPath, QuickLintOptions, results);
+    QuickLintMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    ShowLintResults(doc, std::move(results));
+  }
 
   int NewFileCounter = 1;
 
@@ -728,8 +791,101 @@ class ScriptEditorWindow {
     return finalPath;
   }
 
+  // project files to re-lint, once no full analysis is filling the list
+  std::set<std::string> PendingRelint;
+
+  static bool SamePath(const fs::path &a, const fs::path &b) {
+    std::error_code ec;
+    return fs::absolute(a, ec).lexically_normal() ==
+           fs::absolute(b, ec).lexically_normal();
+  }
+
+  // The globals in names were added or removed, so whoever uses them may
+  // have gained or lost warnings. Open documents are linted again from
+  // their buffers, the project results are patched file by file.
+  void RelintDependents(const std::vector<std::string> &names) {
+    bool haveProjectResults = GlobalAnalysisTotal() > 0;
+    std::vector<std::string> dependents;
+    for (const auto &file : globalsManager.FilesReferencing(names)) {
+      // spelled like the project scan spells it, so results line up
+      fs::path path = (fs::current_path() / file).make_preferred();
+      for (auto &doc : Documents) {
+        if (!doc->FullPath.empty() && SamePath(doc->FullPath, path)) {
+          doc->NeedsLinting = true;
+          doc->LastEditTime = {}; // no need to wait for the debounce
+        }
+      }
+      if (ContinuousAnalysis)
+        dependents.push_back(path.string());
+      else if (haveProjectResults)
+        PendingRelint.insert(path.string());
+    }
+    if (!dependents.empty())
+      linter.PrioritizeInBackground(dependents);
+  }
+
+  void StartRelint() {
+    GlobalLintResults.erase(
+        std::remove_if(GlobalLintResults.begin(), GlobalLintResults.end(),
+                       [this](const LintResult &r) {
+                         return PendingRelint.count(r.file) > 0;
+                       }),
+        GlobalLintResults.end());
+    GlobalLintRevision++;
+    linter.RequestRelint(std::vector<std::string>(PendingRelint.begin(),
+                                                  PendingRelint.end()));
+    PendingRelint.clear();
+  }
+
+  static fs::path ScriptsRoot() {
+    fs::path root = fs::current_path() / "Scripts";
+    if (!fs::exists(root))
+      root = fs::current_path() / "scripts";
+    return root;
+  }
+
+  static bool IsProjectFile(const fs::path &path) {
+    std::error_code ec;
+    fs::path rel = fs::absolute(path, ec).lexically_normal().lexically_relative(
+        fs::absolute(ScriptsRoot(), ec).lexically_normal());
+    return !rel.empty() && *rel.begin() != "..";
+  }
+
+  // Slow down while the user is typing or the UI is struggling to keep
+  // its frame rate, and stay out of the way while the game is paused.
+  BackgroundAnalysis::Pace BackgroundPace() const {
+    if (PausedLine >= 0)
+      return BackgroundAnalysis::Pace::Paused;
+    if (ImGui::IsAnyItemActive() || ImGui::GetIO().DeltaTime > 1.0f / 30.0f)
+      return BackgroundAnalysis::Pace::Gentle;
+    auto now = std::chrono::steady_clock::now();
+    for (const auto &doc : Documents)
+      if (now - doc->LastEditTime < std::chrono::seconds(1))
+        return BackgroundAnalysis::Pace::Gentle;
+    return BackgroundAnalysis::Pace::Full;
+  }
+
+  void ApplyBackgroundUpdates(
+      std::vector<BackgroundAnalysis::Update> &updates) {
+    // a file can come several times, only the latest counts
+    std::unordered_map<std::string, size_t> latest;
+    for (size_t i = 0; i < updates.size(); i++)
+      latest[updates[i].file] = i;
+    GlobalLintResults.erase(
+        std::remove_if(GlobalLintResults.begin(), GlobalLintResults.end(),
+                       [&](const LintResult &r) {
+                         return latest.count(r.file) > 0;
+                       }),
+        GlobalLintResults.end());
+    for (const auto &[file, i] : latest)
+      for (auto &r : updates[i].results)
+        GlobalLintResults.push_back(std::move(r));
+    GlobalLintRevision++;
+  }
+
 public:
   std::vector<LintResult> GlobalLintResults;
+  size_t GlobalLintRevision = 0; // bumped when entries are replaced
   bool IsGlobalAnalysisInProgress = false;
   ScriptEditorWindow() {
     customLuaLang = *TextEditor::Language::Lua();
@@ -740,17 +896,19 @@ public:
     for (const auto &k : keywords)
       customLuaLang.keywords.insert(k);
 
-    fs::path root = fs::current_path() / "Scripts";
-    if (!fs::exists(root))
-      root = fs::current_path() / "scripts";
+    fs::path root = ScriptsRoot();
     globalsManager.SetRoot(root);
 
     // TODO this could be done asynchronically
     globalsManager.ScanAll();
     globalsManager.GenerateConfig();
+    SetupQuickLint();
 
     fs::path configPath = root / ".luacheckrc";
     linter.SetConfigPath(configPath.string());
+    UpdateBackgroundFallback();
+    if (ContinuousAnalysis && fs::exists(root))
+      linter.StartBackground(root.string());
   }
 
   void SetDiffRequestCallback(std::function<void(std::string)> cb) {
@@ -775,39 +933,73 @@ public:
     OnScriptListChanged = cb;
   }
   void RunGlobalAnalysis() {
-    fs::path root = fs::current_path() / "Scripts";
-    if (!fs::exists(root))
-      root = fs::current_path() / "scripts";
-
+    fs::path root = ScriptsRoot();
     if (fs::exists(root)) {
+      GlobalLintResults.clear();
+      GlobalLintRevision++;
+      PendingRelint.clear();
       IsGlobalAnalysisInProgress = true;
       linter.RequestFolderScan(root.string());
     }
   }
+  void CancelGlobalAnalysis() { linter.CancelFolderScan(); }
+  bool WasGlobalAnalysisCancelled() const {
+    return linter.WasFolderScanCancelled();
+  }
+  // files analysed so far / in total
+  size_t GlobalAnalysisDone() const { return linter.FolderScanDone(); }
+  size_t GlobalAnalysisTotal() const { return linter.FolderScanTotal(); }
+  // of those done, unchanged since an earlier run
+  size_t GlobalAnalysisCached() const { return linter.FolderScanCached(); }
+
+  // Continuous analysis replaces the manual project run: results are
+  // patched in file by file as the background sweep finds changes.
+  void SetContinuousAnalysis(bool on) {
+    ContinuousAnalysis = on;
+    fs::path root = ScriptsRoot();
+    if (on && fs::exists(root)) {
+      linter.CancelFolderScan();
+      PendingRelint.clear();
+      linter.StartBackground(root.string());
+    } else {
+      linter.StopBackground();
+    }
+  }
+  bool IsContinuousAnalysis() const { return ContinuousAnalysis; }
+  BackgroundAnalysis::Status GetBackgroundStatus() {
+    return linter.GetBackgroundStatus();
+  }
+  bool IsBackgroundPaused() const { return PausedLine >= 0; }
 
   void UpdateLinting() {
     std::string reqID;
     std::vector<LintResult> resData;
-    bool isFolder = false;
 
-    if (linter.GetResult(reqID, resData, isFolder)) {
-
-      if (isFolder) {
-        GlobalLintResults = resData;
-        IsGlobalAnalysisInProgress = false;
-      } else {
-        for (auto &doc : Documents) {
-          if (doc->FullPath == reqID) {
-            doc->LintWarnings = resData;
-            const auto &bps = GlobalBreakpoints[doc->RelativePathLower];
-            const auto &errs = GlobalErrors[doc->RelativePathLower];
-            doc->RefreshMarkers(bps, errs);
-            break;
-          }
+    while (linter.GetResult(reqID, resData)) {
+      for (auto &doc : Documents) {
+        if (doc->FullPath == reqID) {
+          ShowLintResults(*doc, std::move(resData));
+          break;
         }
       }
     }
-    IsGlobalAnalysisInProgress = linter.IsScanning() && isFolder;
+
+    // project results stream in as each file is done
+    bool scanning = linter.IsFolderScanRunning();
+    linter.CollectFolderResults(GlobalLintResults);
+    IsGlobalAnalysisInProgress = scanning;
+    linter.CollectRelintResults(GlobalLintResults);
+    if (!scanning && !PendingRelint.empty() && !linter.IsRelintRunning())
+      StartRelint();
+
+    if (ContinuousAnalysis) {
+      UpdateBackgroundFallback();
+      linter.SetBackgroundPace(BackgroundPace());
+      std::vector<BackgroundAnalysis::Update> updates;
+      linter.CollectBackgroundUpdates(updates);
+      if (!updates.empty())
+        ApplyBackgroundUpdates(updates);
+    }
 
     if (RealTimeLinting && ActiveDocument) {
       int currentUndo = ActiveDocument->editor.GetUndoIndex();
@@ -834,7 +1026,14 @@ public:
                            .count();
 
         if (elapsed > 500) {
-          linter.RequestLint(doc->FullPath, doc->editor.GetText());
+          std::string text = doc->editor.GetText();
+          QuickLint(*doc, text);
+          if (DeepLinting)
+            linter.RequestLint(doc->FullPath, text, doc == ActiveDocument);
+          // the project view shows what's in the editor, saved or not
+          if (ContinuousAnalysis && !doc->IsCachedView &&
+              !doc->FullPath.empty() && IsProjectFile(doc->FullPath))
+            linter.PrioritizeBufferInBackground(doc->FullPath, text);
 
           doc->LastLintedUndoIndex = currentUndo;
           doc->NeedsLinting = false;
@@ -844,6 +1043,7 @@ public:
   }
 
   std::shared_ptr<ScriptDocument> GetActiveDocument() { return ActiveDocument; }
+  const GlobalsManager &GetGlobals() const { return globalsManager; }
   void ForceLintActive() {
     if (ActiveDocument)
       ActiveDocument->MarkDirtyForLint();
@@ -1023,8 +1223,10 @@ public:
     }
 
     if (doc->Save()) {
-      globalsManager.ScanFile(doc->FullPath);
+      auto changed = globalsManager.ScanFile(doc->FullPath);
       globalsManager.GenerateConfig();
+      if (!changed.empty())
+        RelintDependents(changed);
 
       if (AutoReloadOnSave && OnReloadRequested) {
         OnReloadRequested(doc->RelativePathLower);
@@ -1071,6 +1273,21 @@ public:
                             &AutoLintOnSave)) {
         }
         ImGui::MenuItem("Real-time Analysis", nullptr, &RealTimeLinting);
+        if (ImGui::IsItemHovered())
+          ImGui::SetTooltip("Built-in pass: last %.2f ms", QuickLintMs);
+        ImGui::MenuItem("Deep Analysis (Luacheck)", nullptr, &DeepLinting);
+        if (ImGui::IsItemHovered()) {
+          LintTiming t = linter.GetTiming();
+          if (t.count + t.cached > 0)
+            ImGui::SetTooltip("%llu lints (%llu cancelled, %llu cached), "
+                              "last %.1f ms, avg %.1f ms, max %.1f ms\n%s",
+                              (unsigned long long)t.count,
+                              (unsigned long long)t.cancelled,
+                              (unsigned long long)t.cached, t.lastMs,
+                              t.avgMs, t.maxMs,
+                              t.pooled ? "persistent luacheck host"
+                                       : "one luacheck process per lint");
+        }
         ImGui::EndMenu();
       }
       if (ImGui::BeginMenu("Scripts")) {
@@ -1123,6 +1340,10 @@ public:
         ImGui::SetItemDefaultFocus();
         ImGui::SameLine();
         if (ImGui::Button("Discard", ImVec2(120, 0))) {
+          // back to what's on disk in the project view
+          if (ContinuousAnalysis && !PendingCloseDoc->FullPath.empty() &&
+              IsProjectFile(PendingCloseDoc->FullPath))
+            linter.PrioritizeInBackground({PendingCloseDoc->FullPath});
           auto it =
               std::find(Documents.begin(), Documents.end(), PendingCloseDoc);
           if (it != Documents.end())
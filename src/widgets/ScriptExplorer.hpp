@@ -1,4 +1,5 @@
 #pragma once
+#include "../tools/TextMatch.hpp"
 #include "imgui.h"
 #include <algorithm>
 #include <cctype>
@@ -40,15 +41,9 @@ class ScriptExplorer {
 
   std::function<void(std::string)> OnFileSelected;
 
-  bool StringContains(std::string haystack, std::string needle) {
-    if (needle.empty())
-      return true;
-    auto toLower = [](std::string s) {
-      std::transform(s.begin(), s.end(), s.begin(),
-                     [](unsigned char c) { return std::tolower(c); });
-      return s;
-    };
-    return toLower(haystack).find(toLower(needle)) != std::string::npos;
+  // needle is expected to be folded already, see TextMatch::FoldCopy
+  bool StringContains(std::string_view haystack, std::string_view needle) {
+    return TextMatch::Contains(haystack, needle);
   }
 
   void BuildTreeRecursive(const fs::path &path, CachedFolder &outFolder) {
@@ -148,8 +143,7 @@ public:
 
     BuildTreeRecursive(RootPath, RootFolderCache);
 
-    std::string filter = SearchBuf;
-    FilterTreeRecursive(RootFolderCache, filter);
+    FilterTreeRecursive(RootFolderCache, TextMatch::FoldCopy(SearchBuf));
   }
 
   void SetSelectionCallback(std::function<void(std::string)> cb) {
@@ -166,7 +160,7 @@ public:
 
     if (std::string(SearchBuf) != LastSearchBuf) {
       LastSearchBuf = SearchBuf;
-      FilterTreeRecursive(RootFolderCache, LastSearchBuf);
+      FilterTreeRecursive(RootFolderCache, TextMatch::FoldCopy(LastSearchBuf));
     }
 
     bool isFiltering = !LastSearchBuf.empty();
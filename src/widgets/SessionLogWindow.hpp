@@ -0,0 +1,101 @@
+#pragma once
+#include "../tools/LogSink.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+class SessionLogWindow {
+  LogSink *Sink = nullptr;
+  LogSinkConfig Config;
+  char DirectoryBuf[512] = "logs";
+  int MaxFileMB = 64;
+
+  void ApplyConfig() {
+    Config.Directory = DirectoryBuf;
+    Config.MaxFileBytes = (size_t)std::max(MaxFileMB, 1) << 20;
+    if (Sink->IsEnabled())
+      Sink->SetConfig(Config);
+  }
+
+  static void FormatBytes(uint64_t bytes, char *buf, size_t size) {
+    if (bytes >= (1ull << 30))
+      snprintf(buf, size, "%.2f GB", bytes / (double)(1ull << 30));
+    else if (bytes >= (1ull << 20))
+      snprintf(buf, size, "%.1f MB", bytes / (double)(1ull << 20));
+    else
+      snprintf(buf, size, "%.1f KB", bytes / 1024.0);
+  }
+
+public:
+  void Setup(LogSink *sink) { Sink = sink; }
+
+  void Draw(const char *title, bool *p_open = nullptr) {
+    ImGui::SetNextWindowSize(ImVec2(420, 260), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(title, p_open)) {
+      ImGui::End();
+      return;
+    }
+    if (!Sink) {
+      ImGui::End();
+      return;
+    }
+
+    bool enabled = Sink->IsEnabled();
+    if (ImGui::Checkbox("Record session to disk", &enabled)) {
+      if (enabled) {
+        ApplyConfig();
+        Sink->Start(Config);
+      } else {
+        Sink->Stop();
+      }
+    }
+
+    bool changed = false;
+    const char *formats[] = {"Text", "Binary archive", "Text + archive"};
+    int format = (int)Config.Format;
+    if (ImGui::Combo("Format", &format, formats, IM_ARRAYSIZE(formats))) {
+      Config.Format = (LogSinkFormat)format;
+      changed = true;
+    }
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Archives (.sal) open in the Log Archive window");
+    if (ImGui::InputText("Directory", DirectoryBuf, sizeof(DirectoryBuf),
+                         ImGuiInputTextFlags_EnterReturnsTrue))
+      changed = true;
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Press Enter to apply, used for the next file");
+    changed |= ImGui::InputInt("Max file size (MB)", &MaxFileMB);
+    changed |= ImGui::InputInt("Max file age (min)", &Config.MaxFileMinutes);
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("0 rotates by size only");
+    changed |= ImGui::Checkbox("Compress closed text files", &Config.Compress);
+    if (changed) {
+      Config.MaxFileMinutes = std::max(Config.MaxFileMinutes, 0);
+      ApplyConfig();
+    }
+
+    ImGui::Separator();
+    char bytes[32];
+    FormatBytes(Sink->WrittenBytes(), bytes, sizeof(bytes));
+    ImGui::Text("Written: %llu lines (%s)",
+                (unsigned long long)Sink->WrittenLines(), bytes);
+    ImGui::Text("Queued: %zu", Sink->PendingLines());
+    uint64_t dropped = Sink->DroppedLines();
+    if (dropped > 0)
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f),
+                         "Dropped: %llu lines",
+                         (unsigned long long)dropped);
+    else
+      ImGui::Text("Dropped: 0");
+
+    std::string file = Sink->CurrentFile();
+    if (!file.empty())
+      ImGui::TextWrapped("File: %s", file.c_str());
+    std::string error = Sink->Error();
+    if (!error.empty())
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+
+    ImGui::End();
+  }
+};
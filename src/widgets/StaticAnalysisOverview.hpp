@@ -1,19 +1,23 @@
 #pragma once
+#include "../tools/TextMatch.hpp"
 #include "ScriptEditorWindow.hpp"
 #include "imgui.h"
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <string>
 #include <vector>
 
 class StaticAnalysisOverview {
   ScriptEditorWindow *EditorRef = nullptr;
   ImGuiTextFilter Filter;
+  TextMatch::Filter Matcher;
   bool ShowErrorsOnly = false;
 
   std::vector<int> FilteredIndices;
   bool FilterDirty = true;
   size_t LastResultsSize = 0;
+  size_t LastRevision = 0;
 
   std::string GetShortPath(const std::string &fullPath) {
     std::string lower = fullPath;
@@ -32,18 +36,19 @@ class StaticAnalysisOverview {
       return;
     FilteredIndices.clear();
     const auto &results = EditorRef->GlobalLintResults;
+    Matcher.Build(Filter.InputBuf);
 
     for (int i = 0; i < results.size(); ++i) {
       const auto &item = results[i];
       if (ShowErrorsOnly && item.type != "E")
         continue;
-      if (!Filter.PassFilter(item.file.c_str()) &&
-          !Filter.PassFilter(item.message.c_str()))
+      if (!Matcher.Pass(item.file) && !Matcher.Pass(item.message))
         continue;
       FilteredIndices.push_back(i);
     }
     FilterDirty = false;
     LastResultsSize = results.size();
+    LastRevision = EditorRef->GlobalLintRevision;
   }
 
 public:
@@ -60,20 +65,65 @@ public:
       ImGui::End();
       return;
     }
-    if (EditorRef->GlobalLintResults.size() != LastResultsSize) {
+    if (EditorRef->GlobalLintResults.size() != LastResultsSize ||
+        EditorRef->GlobalLintRevision != LastRevision) {
       FilterDirty = true;
     }
 
-    if (ImGui::Button("Run Analysis (All Scripts)")) {
-      EditorRef->RunGlobalAnalysis();
-    }
-
+    bool continuous = EditorRef->IsContinuousAnalysis();
+    if (ImGui::Checkbox("Continuous", &continuous))
+      EditorRef->SetContinuousAnalysis(continuous);
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("Keep the results current in the background.\n"
+                        "Turn off to run the analysis by hand.");
     ImGui::SameLine();
-    if (EditorRef->IsGlobalAnalysisInProgress) {
-      ImGui::TextColored(ImVec4(1, 1, 0, 1), "Scanning... Please wait.");
-    } else {
-      ImGui::TextDisabled("%zu issues found.",
+
+    if (continuous) {
+      auto status = EditorRef->GetBackgroundStatus();
+      if (EditorRef->IsBackgroundPaused())
+        ImGui::TextDisabled("Paused while the game is, %zu issues.",
+                            EditorRef->GlobalLintResults.size());
+      else
+        ImGui::TextDisabled("Checked %zu/%zu files this pass, %zu issues.",
+                            status.swept, status.total,
+                            EditorRef->GlobalLintResults.size());
+      if (status.builtin) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.0f, 1.0f),
+                           "(built-in checks only)");
+        if (ImGui::IsItemHovered())
+          ImGui::SetTooltip("luacheck could not be run, so only the editor's "
+                            "own checks are used.\nIt is tried again when the "
+                            "config changes.");
+      }
+    } else if (EditorRef->IsGlobalAnalysisInProgress) {
+      if (ImGui::Button("Cancel"))
+        EditorRef->CancelGlobalAnalysis();
+      ImGui::SameLine();
+      size_t done = EditorRef->GlobalAnalysisDone();
+      size_t total = EditorRef->GlobalAnalysisTotal();
+      char overlay[64];
+      snprintf(overlay, sizeof(overlay), "%zu/%zu files", done, total);
+      ImGui::ProgressBar(total ? (float)done / (float)total : 0.0f,
+                         ImVec2(200, 0), overlay);
+      ImGui::SameLine();
+      ImGui::TextDisabled("%zu issues so far",
                           EditorRef->GlobalLintResults.size());
+    } else {
+      if (ImGui::Button("Run Analysis (All Scripts)")) {
+        EditorRef->RunGlobalAnalysis();
+      }
+      ImGui::SameLine();
+      if (EditorRef->WasGlobalAnalysisCancelled())
+        ImGui::TextDisabled("Cancelled after %zu/%zu files, %zu issues.",
+                            EditorRef->GlobalAnalysisDone(),
+                            EditorRef->GlobalAnalysisTotal(),
+                            EditorRef->GlobalLintResults.size());
+      else
+        ImGui::TextDisabled("%zu issues found (%zu of %zu files unchanged).",
+                            EditorRef->GlobalLintResults.size(),
+                            EditorRef->GlobalAnalysisCached(),
+                            EditorRef->GlobalAnalysisTotal());
     }
 
     ImGui::Separator();
@@ -0,0 +1,150 @@
+#pragma once
+#include "../tools/LogTriggers.hpp"
+#include "LogWindow.hpp"
+#include "imgui.h"
+#include <cstring>
+#include <string>
+
+class TriggerWindow {
+  LogTriggers *Triggers = nullptr;
+  char NewPattern[256] = "";
+  bool AutoScroll = true;
+
+  void DrawTriggerTable() {
+    if (!ImGui::BeginTable("TriggerTable", 7,
+                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                               ImGuiTableFlags_Resizable))
+      return;
+
+    ImGui::TableSetupColumn("Pattern", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Hits", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+    ImGui::TableSetupColumn("Mark", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+    ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed, 40.0f);
+    ImGui::TableSetupColumn("Pane", ImGuiTableColumnFlags_WidthFixed, 40.0f);
+    ImGui::TableSetupColumn("Pause", ImGuiTableColumnFlags_WidthFixed, 40.0f);
+    ImGui::TableSetupColumn("##del", ImGuiTableColumnFlags_WidthFixed, 24.0f);
+    ImGui::TableHeadersRow();
+
+    int removeId = 0;
+    for (const auto &entry : Triggers->List()) {
+      LogTrigger *t = Triggers->Find(entry.Id);
+      if (!t)
+        continue;
+      ImGui::PushID(t->Id);
+      ImGui::TableNextRow();
+
+      ImGui::TableSetColumnIndex(0);
+      char buf[256];
+      strncpy(buf, t->Pattern.c_str(), sizeof(buf) - 1);
+      buf[sizeof(buf) - 1] = '\0';
+      ImGui::SetNextItemWidth(-FLT_MIN);
+      if (ImGui::InputText("##pattern", buf, sizeof(buf),
+                           ImGuiInputTextFlags_EnterReturnsTrue))
+        Triggers->SetPattern(t->Id, buf);
+      if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Press Enter to apply");
+
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%zu", t->Hits);
+
+      ImGui::TableSetColumnIndex(2);
+      ImGui::Checkbox("##mark", &t->Highlight);
+      ImGui::SameLine();
+      ImVec4 col = ImGui::ColorConvertU32ToFloat4(t->HighlightColor);
+      if (ImGui::ColorEdit4("##color", &col.x,
+                            ImGuiColorEditFlags_NoInputs |
+                                ImGuiColorEditFlags_AlphaPreview))
+        t->HighlightColor = ImGui::ColorConvertFloat4ToU32(col);
+
+      ImGui::TableSetColumnIndex(3);
+      ImGui::Checkbox("##count", &t->Count);
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Checkbox("##pane", &t->ToPane);
+      ImGui::TableSetColumnIndex(5);
+      ImGui::Checkbox("##pause", &t->Pause);
+      if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Break into the debugger when this matches");
+
+      ImGui::TableSetColumnIndex(6);
+      if (ImGui::SmallButton("X"))
+        removeId = t->Id;
+      ImGui::PopID();
+    }
+    ImGui::EndTable();
+
+    if (removeId)
+      Triggers->Remove(removeId);
+  }
+
+  void DrawHitPane() {
+    if (ImGui::Button("Clear Hits"))
+      Triggers->ResetCounts();
+    ImGui::SameLine();
+    ImGui::Checkbox("Auto-scroll", &AutoScroll);
+    ImGui::SameLine();
+    ImGui::TextDisabled("%zu hits", Triggers->PaneHits.size());
+
+    ImGui::BeginChild("TriggerHits", ImVec2(0, 0), true,
+                      ImGuiWindowFlags_HorizontalScrollbar);
+    ImGuiListClipper clipper;
+    clipper.Begin((int)Triggers->PaneHits.size());
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        const auto &hit = Triggers->PaneHits[i];
+        char timeText[32];
+        LogWindow::FormatTime(hit.TimeMs, timeText, sizeof(timeText));
+        LogTrigger *t = Triggers->Find(hit.TriggerId);
+
+        ImGui::TextDisabled("%s", timeText);
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.2f, 1.0f), "{%s}",
+                           t ? t->Pattern.c_str() : "removed");
+        ImGui::SameLine();
+        if (hit.Channel.empty())
+          ImGui::TextUnformatted(hit.Message.c_str());
+        else
+          ImGui::Text("[%s] %s", hit.Channel.c_str(), hit.Message.c_str());
+      }
+    }
+    clipper.End();
+    if (AutoScroll && ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+      ImGui::SetScrollHereY(1.0f);
+    ImGui::EndChild();
+  }
+
+public:
+  void Setup(LogTriggers *triggers) { Triggers = triggers; }
+
+  void Draw(const char *title, bool *p_open = nullptr) {
+    ImGui::SetNextWindowSize(ImVec2(600, 400), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(title, p_open)) {
+      ImGui::End();
+      return;
+    }
+    if (!Triggers) {
+      ImGui::End();
+      return;
+    }
+
+    ImGui::SetNextItemWidth(-80.0f);
+    bool add = ImGui::InputTextWithHint("##new", "Pattern (case insensitive)",
+                                        NewPattern, sizeof(NewPattern),
+                                        ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    add |= ImGui::Button("Add");
+    if (add && NewPattern[0] != '\0') {
+      Triggers->Add(NewPattern);
+      NewPattern[0] = '\0';
+    }
+
+    ImGui::TextDisabled("%zu patterns, %zu automaton states%s",
+                        Triggers->List().size(), Triggers->StateCount(),
+                        Triggers->IsRebuilding() ? " (rebuilding...)" : "");
+
+    DrawTriggerTable();
+    ImGui::Separator();
+    DrawHitPane();
+
+    ImGui::End();
+  }
+};